@@ -0,0 +1,95 @@
+#include <new>
+
+#include "arena.hpp"
+
+namespace TDMS
+{
+
+class new_delete_memory_resource : public memory_resource
+{
+public:
+    void* allocate(size_t bytes, size_t) override
+    {
+        return ::operator new(bytes);
+    }
+    void deallocate(void* p, size_t, size_t) override
+    {
+        ::operator delete(p);
+    }
+};
+
+memory_resource* new_delete_resource()
+{
+    static new_delete_memory_resource resource;
+    return &resource;
+}
+
+arena::arena(memory_resource* upstream, size_t block_size)
+    : _upstream(upstream != nullptr ? upstream : new_delete_resource()),
+      _block_size(block_size),
+      _blocks(nullptr),
+      _current(nullptr),
+      _remaining(0),
+      _used(0),
+      _reserved(0)
+{
+}
+
+arena::~arena()
+{
+    release();
+}
+
+void* arena::allocate(size_t bytes, size_t alignment)
+{
+    size_t padding = (alignment - (uintptr_t(_current) & (alignment - 1)))
+        & (alignment - 1);
+    if(_current == nullptr || padding + bytes > _remaining)
+    {
+        // Blocks grow with the arena, so big files need few of them
+        size_t size = _block_size;
+        if(_reserved / 2 > size)
+            size = _reserved / 2;
+        if(bytes + alignment + sizeof(block) > size)
+            size = bytes + alignment + sizeof(block);
+        block* b = static_cast<block*>(_upstream->allocate(size,
+                    alignof(std::max_align_t)));
+        b->next = _blocks;
+        b->size = size;
+        _blocks = b;
+        _reserved += size;
+        _current = reinterpret_cast<unsigned char*>(b) + sizeof(block);
+        _remaining = size - sizeof(block);
+        padding = (alignment - (uintptr_t(_current) & (alignment - 1)))
+            & (alignment - 1);
+    }
+    void* p = _current + padding;
+    _current += padding + bytes;
+    _remaining -= padding + bytes;
+    _used += bytes;
+    return p;
+}
+
+string_ref arena::copy(const char* s, size_t n)
+{
+    char* p = static_cast<char*>(allocate(n, 1));
+    if(n != 0)
+        memcpy(p, s, n);
+    return string_ref(p, n);
+}
+
+void arena::release()
+{
+    while(_blocks != nullptr)
+    {
+        block* next = _blocks->next;
+        _upstream->deallocate(_blocks, _blocks->size, alignof(std::max_align_t));
+        _blocks = next;
+    }
+    _current = nullptr;
+    _remaining = 0;
+    _used = 0;
+    _reserved = 0;
+}
+
+}
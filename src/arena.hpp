@@ -0,0 +1,159 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <new>
+
+namespace TDMS
+{
+
+// Source of memory, modeled after std::pmr::memory_resource
+class memory_resource
+{
+public:
+    virtual ~memory_resource() {}
+    virtual void* allocate(size_t bytes, size_t alignment) = 0;
+    virtual void deallocate(void* p, size_t bytes, size_t alignment) = 0;
+};
+
+// Resource using operator new and delete
+memory_resource* new_delete_resource();
+
+// Non-owning string, usually pointing into an arena
+struct string_ref
+{
+    string_ref()
+        : data(nullptr),
+          size(0)
+    {
+    }
+    string_ref(const char* d, size_t s)
+        : data(d),
+          size(s)
+    {
+    }
+    string_ref(const std::string& s)
+        : data(s.data()),
+          size(s.size())
+    {
+    }
+
+    std::string str() const
+    {
+        return std::string(data, size);
+    }
+
+    bool operator<(const string_ref& other) const
+    {
+        size_t n = size < other.size ? size : other.size;
+        int c = (n == 0) ? 0 : memcmp(data, other.data, n);
+        return c < 0 || (c == 0 && size < other.size);
+    }
+    bool operator==(const string_ref& other) const
+    {
+        return size == other.size
+            && (size == 0 || memcmp(data, other.data, size) == 0);
+    }
+    bool operator!=(const string_ref& other) const
+    {
+        return !(*this == other);
+    }
+
+    const char* data;
+    size_t size;
+};
+
+// Monotonic allocator: hands out memory from large blocks taken from an
+// upstream resource, and gives it all back at once on release().
+// Nothing allocated from it gets destructed.
+class arena
+{
+public:
+    explicit arena(memory_resource* upstream = nullptr,
+            size_t block_size = 64*1024);
+    ~arena();
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    // Copies n characters into the arena
+    string_ref copy(const char* s, size_t n);
+
+    void release();
+
+    // Bytes handed out, and bytes taken from upstream
+    size_t bytes_used() const
+    {
+        return _used;
+    }
+    size_t bytes_reserved() const
+    {
+        return _reserved;
+    }
+private:
+    struct block
+    {
+        block* next;
+        size_t size;
+    };
+
+    memory_resource* _upstream;
+    size_t _block_size;
+    block* _blocks;
+    unsigned char* _current;
+    size_t _remaining;
+    size_t _used;
+    size_t _reserved;
+};
+
+// Standard allocator drawing from an arena; deallocation is a no-op
+template<typename T>
+class arena_allocator
+{
+public:
+    typedef T value_type;
+
+    arena_allocator(arena* a)
+        : _arena(a)
+    {
+    }
+    template<typename U>
+    arena_allocator(const arena_allocator<U>& other)
+        : _arena(other._arena)
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T*, size_t)
+    {
+    }
+
+    template<typename U>
+    bool operator==(const arena_allocator<U>& other) const
+    {
+        return _arena == other._arena;
+    }
+    template<typename U>
+    bool operator!=(const arena_allocator<U>& other) const
+    {
+        return _arena != other._arena;
+    }
+
+    arena* _arena;
+};
+
+template<typename T>
+using arena_vector = std::vector<T, arena_allocator<T>>;
+
+template<typename K, typename V>
+using arena_map = std::map<K, V, std::less<K>,
+      arena_allocator<std::pair<const K, V>>>;
+
+}
@@ -0,0 +1,94 @@
+#include <algorithm>
+
+#include "batch_reader.hpp"
+
+namespace TDMS
+{
+
+namespace
+{
+
+// Columns are decoded into a block this size, which stays in cache
+// while it is transposed
+const size_t block_bytes = 64 << 10;
+
+}
+
+batch_reader::batch_reader(const std::vector<const object*>& channels,
+        numeric_type t, batch_layout layout)
+    : _channels(channels),
+      _type(t),
+      _value_size(numeric_type_size(t)),
+      _layout(layout),
+      _transpose(kernels::transposer(numeric_type_size(t))),
+      _rows(0),
+      _position(0),
+      _block_rows(0)
+{
+    if(_channels.empty())
+    {
+        throw std::invalid_argument("A batch needs at least one channel");
+    }
+    if(_transpose == nullptr || t == numeric_type::EXTENDED)
+    {
+        throw std::invalid_argument("Can't read into this numeric type");
+    }
+    _rows = _channels.front()->number_values();
+    for(const object* o : _channels)
+    {
+        if(o->number_values() != _rows)
+        {
+            throw std::invalid_argument("Channel " + o->get_path() + " holds "
+                    + std::to_string(o->number_values()) + " values instead of "
+                    + std::to_string(_rows));
+        }
+    }
+    if(_layout == batch_layout::ROW_MAJOR)
+    {
+        _block_rows = std::max<size_t>(16,
+                block_bytes / (_channels.size() * _value_size));
+        _block.resize(_block_rows * _channels.size() * _value_size);
+    }
+}
+
+size_t batch_reader::read(void* target, size_t rows)
+{
+    size_t n = std::min(rows, _rows - _position);
+    unsigned char* out = static_cast<unsigned char*>(target);
+    size_t columns = _channels.size();
+    if(_layout == batch_layout::COLUMN_MAJOR)
+    {
+        for(size_t c = 0; c < columns; ++c)
+        {
+            read_into(_channels[c], _type, out + c*rows*_value_size,
+                    _position, n);
+        }
+    }
+    else
+    {
+        for(size_t done = 0; done < n; done += _block_rows)
+        {
+            size_t m = std::min(_block_rows, n - done);
+            for(size_t c = 0; c < columns; ++c)
+            {
+                read_into(_channels[c], _type, _block.data() + c*m*_value_size,
+                        _position + done, m);
+            }
+            _transpose(_block.data(), m, columns,
+                    out + done*columns*_value_size);
+        }
+    }
+    _position += n;
+    return n;
+}
+
+void batch_reader::seek(size_t row)
+{
+    if(row > _rows)
+    {
+        throw std::out_of_range("Seeking past the end of the batch");
+    }
+    _position = row;
+}
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <stdexcept>
+#include <vector>
+
+#include "tdms.hpp"
+
+namespace TDMS
+{
+
+enum class batch_layout
+{
+    // All channels of the first row, then of the second row, ...
+    ROW_MAJOR,
+    // All rows of the first channel, then of the second channel, ...
+    COLUMN_MAJOR
+};
+
+// Reads channels of the same length side by side, a batch of rows at a
+// time, into a buffer of the caller. The channels are checked once and
+// the buffers are kept, so every batch only decodes and transposes.
+class batch_reader
+{
+public:
+    // Throws std::invalid_argument if there are no channels or they
+    // differ in length, or if values can't be read as t.
+    batch_reader(const std::vector<const object*>& channels, numeric_type t,
+            batch_layout layout = batch_layout::ROW_MAJOR);
+
+    // Reads up to rows rows from the current row on into target, which
+    // holds rows * channels() values. In a column major batch, channel c
+    // starts at value c * rows, also for a last batch that isn't full.
+    // Returns the number of rows read, 0 at the end.
+    size_t read(void* target, size_t rows);
+
+    template<typename T>
+    size_t read(T* target, size_t rows)
+    {
+        if(numeric_type_of<T>::value != _type)
+        {
+            throw std::invalid_argument("Batch doesn't hold this numeric type");
+        }
+        return read(static_cast<void*>(target), rows);
+    }
+
+    void seek(size_t row);
+    size_t position() const
+    {
+        return _position;
+    }
+    size_t rows() const
+    {
+        return _rows;
+    }
+    size_t channels() const
+    {
+        return _channels.size();
+    }
+private:
+    std::vector<const object*> _channels;
+    numeric_type _type;
+    size_t _value_size;
+    batch_layout _layout;
+    kernels::transpose_t _transpose;
+    size_t _rows;
+    size_t _position;
+    // Rows decoded column by column before the transpose
+    size_t _block_rows;
+    std::vector<unsigned char> _block;
+};
+
+}
@@ -0,0 +1,110 @@
+#include "channel_cache.hpp"
+#include "tdms.hpp"
+
+namespace TDMS
+{
+
+channel_cache::channel_cache(size_t budget)
+    : _budget(budget),
+      _bytes(0),
+      _hits(0),
+      _misses(0),
+      _evictions(0)
+{
+}
+
+channel_cache::~channel_cache()
+{
+}
+
+channel_cache& channel_cache::global()
+{
+    static channel_cache cache;
+    return cache;
+}
+
+void channel_cache::set_budget(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _budget = bytes;
+    _evict();
+}
+
+channel_cache::statistics channel_cache::stats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return statistics{_hits, _misses, _evictions, _bytes, _budget};
+}
+
+void channel_cache::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _lru.clear();
+    _entries.clear();
+    _bytes = 0;
+}
+
+std::shared_ptr<const void> channel_cache::_get(const object* o)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _entries.find(o);
+        if(it != _entries.end())
+        {
+            ++_hits;
+            _lru.splice(_lru.begin(), _lru, it->second);
+            return it->second->values;
+        }
+        ++_misses;
+    }
+
+    // Decode without holding the lock, other channels can be served
+    // in the meantime.
+    std::shared_ptr<const void> values = o->_decode();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _entries.find(o);
+    if(it != _entries.end())
+    {
+        // Another thread was first
+        _lru.splice(_lru.begin(), _lru, it->second);
+        return it->second->values;
+    }
+    _lru.push_front(entry{o, values, o->bytes()});
+    _entries[o] = _lru.begin();
+    _bytes += o->bytes();
+    _evict();
+    return values;
+}
+
+void channel_cache::_forget(const object* o)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _entries.find(o);
+    if(it == _entries.end())
+        return;
+    _bytes -= it->second->bytes;
+    _lru.erase(it->second);
+    _entries.erase(it);
+}
+
+size_t channel_cache::_bytes_of(const object* o) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _entries.find(o);
+    return it == _entries.end() ? 0 : it->second->bytes;
+}
+
+void channel_cache::_evict()
+{
+    while(_bytes > _budget && !_lru.empty())
+    {
+        const entry& e = _lru.back();
+        _bytes -= e.bytes;
+        _entries.erase(e.o);
+        _lru.pop_back();
+        ++_evictions;
+    }
+}
+
+}
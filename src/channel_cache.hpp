@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace TDMS
+{
+
+class object;
+
+// Decoded channels of any number of files, kept within a byte budget.
+// Files opened with a cache don't decode their numeric channels up
+// front; object::values() decodes them on first use and the least
+// recently used ones are dropped again when the budget is exceeded.
+class channel_cache
+{
+public:
+    struct statistics
+    {
+        size_t hits;
+        size_t misses;
+        size_t evictions;
+        // Decoded bytes currently held by the cache
+        size_t bytes;
+        size_t budget;
+    };
+
+    explicit channel_cache(size_t budget = 256 << 20);
+    ~channel_cache();
+    channel_cache(const channel_cache&) = delete;
+    channel_cache& operator=(const channel_cache&) = delete;
+
+    // The cache shared by the whole process
+    static channel_cache& global();
+
+    // Evicts channels until the new budget is met
+    void set_budget(size_t bytes);
+    statistics stats() const;
+    void clear();
+
+private:
+    friend class object;
+    friend class file;
+    friend class file_state;
+
+    // Decoded values of o, from the cache or decoded now. They stay
+    // valid for as long as the returned pointer is held, evicted or not.
+    std::shared_ptr<const void> _get(const object* o);
+    // Drops o, its file is going away
+    void _forget(const object* o);
+    // Decoded bytes of o held by the cache, 0 if it isn't cached
+    size_t _bytes_of(const object* o) const;
+    void _evict();
+
+    struct entry
+    {
+        const object* o;
+        std::shared_ptr<const void> values;
+        size_t bytes;
+    };
+
+    mutable std::mutex _mutex;
+    // Most recently used first
+    std::list<entry> _lru;
+    std::unordered_map<const object*, std::list<entry>::iterator> _entries;
+    size_t _budget;
+    size_t _bytes;
+    size_t _hits;
+    size_t _misses;
+    size_t _evictions;
+};
+
+}
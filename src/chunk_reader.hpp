@@ -0,0 +1,160 @@
+#pragma once
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+
+#include "tdms.hpp"
+
+namespace TDMS
+{
+
+// Reads the values of an object front to back, one chunk at a time, in
+// constant memory. A chunk never spans segments. When the raw samples
+// already are densely packed, aligned, little endian T the chunk points
+// straight into the file contents; otherwise it is decoded into a
+// buffer that is reused for every chunk.
+template<typename T>
+class chunk_reader
+{
+public:
+    // Values [start, start + count) of the object. Valid until the next
+    // chunk is read.
+    struct chunk
+    {
+        size_t start;
+        const T* data;
+        size_t count;
+
+        const T* begin() const
+        {
+            return data;
+        }
+        const T* end() const
+        {
+            return data + count;
+        }
+    };
+
+    class iterator
+    {
+        friend class chunk_reader;
+    public:
+        const chunk& operator*() const
+        {
+            return _chunk;
+        }
+        const chunk* operator->() const
+        {
+            return &_chunk;
+        }
+        iterator& operator++()
+        {
+            if(!_reader->next(_chunk))
+                _reader = nullptr;
+            return *this;
+        }
+        bool operator!=(const iterator& other) const
+        {
+            return _reader != other._reader;
+        }
+    private:
+        explicit iterator(chunk_reader* reader)
+            : _reader(reader),
+              _chunk{0, nullptr, 0}
+        {
+            if(_reader != nullptr && !_reader->next(_chunk))
+                _reader = nullptr;
+        }
+        chunk_reader* _reader;
+        chunk _chunk;
+    };
+
+    static const size_t default_chunk_values = 1 << 16;
+
+    // Reads count values from start on, at most chunk_values at a time
+    explicit chunk_reader(const object* o,
+            size_t chunk_values = default_chunk_values, size_t start = 0,
+            size_t count = size_t(-1))
+        : _object(o),
+          _chunk_values(std::max<size_t>(chunk_values, 1)),
+          _value(start),
+          _end(start + std::min(count, o->number_values() - std::min(start,
+                          o->number_values()))),
+          _extent(0),
+          _offset(0)
+    {
+        if(start > o->number_values())
+        {
+            throw std::out_of_range("Reading past the end of object "
+                    + o->get_path());
+        }
+        const object_table& table = *o->_table;
+        if(table._flags[o->_index] & object_table::SKIPPED)
+        {
+            throw std::runtime_error("Object " + o->get_path()
+                    + " wasn't selected when opening");
+        }
+        if(_value < _end)
+        {
+            _extent = table._extent_at(o->_index, start);
+            _offset = start - table._extent_starts[
+                table._extent_ranges[o->_index].begin + _extent];
+        }
+    }
+
+    // Reads the next chunk into c, false once all values were read
+    bool next(chunk& c)
+    {
+        if(_value >= _end)
+            return false;
+        const object_table& table = *_object->_table;
+        array_view<object::extent> extents = table._extents_of(_object->_index);
+        while(_offset == extents[_extent].number_values)
+        {
+            ++_extent;
+            _offset = 0;
+        }
+        const object::extent& e = extents[_extent];
+        size_t n = std::min(std::min(_chunk_values, e.number_values - _offset),
+                _end - _value);
+        const unsigned char* source = e.data + _offset*e.stride;
+        if(e.bit < 0 && e.type == numeric_type_of<T>::value && !e.big_endian
+                && e.stride == sizeof(T)
+                && uintptr_t(source) % alignof(T) == 0)
+        {
+            c.data = reinterpret_cast<const T*>(source);
+        }
+        else
+        {
+            if(_buffer.size() < n)
+                _buffer.resize(std::min(_chunk_values, _end - _value));
+            read_as(_object, _buffer.data(), _value, n);
+            c.data = _buffer.data();
+        }
+        c.start = _value;
+        c.count = n;
+        _value += n;
+        _offset += n;
+        return true;
+    }
+
+    iterator begin()
+    {
+        return iterator(this);
+    }
+    iterator end()
+    {
+        return iterator(nullptr);
+    }
+private:
+    const object* _object;
+    size_t _chunk_values;
+    size_t _value;
+    size_t _end;
+    // Position of _value in the extents
+    size_t _extent;
+    size_t _offset;
+    std::vector<T> _buffer;
+};
+
+}
@@ -1,8 +1,11 @@
+#pragma once
 #include <cstdint>
 #include <ctime>
 #include <string>
 #include <string.h> // For memcpy
 #include "log.hpp"
+#include "tdms.hpp"
+#include "tdms_impl.hpp"
 
 namespace TDMS
 {
@@ -18,20 +21,46 @@ T read_le(const unsigned char* p)
     return sum;
 }
 
-time_t read_timestamp(const unsigned char* p)
+template<typename T>
+T read_be(const unsigned char* p)
+{
+    T sum = p[sizeof(T) - 1];
+    for(size_t i = 1; i < sizeof(T); ++i)
+    {
+        sum |= T(p[sizeof(T) - 1 - i]) << (8*i);
+    }
+    return sum;
+}
+
+template<typename T>
+inline T read_number(const unsigned char* p, endianness e)
+{
+    return (e == BIG) ? read_be<T>(p) : read_le<T>(p);
+}
+
+// A length prefixed string. It stays in the file contents.
+inline string_ref read_string_ref(const unsigned char* p, endianness e)
+{
+    uint32_t len = read_number<uint32_t>(p, e);
+    return string_ref((const char*)p + 4, len);
+}
+
+// Little endian: the fractions come first
+inline void read_timestamp(const unsigned char* p, void* target)
 {
-    // TODO: implement
-    time_t result = time(NULL);
-    return result;
+    timestamp t;
+    t.fractions = read_le<uint64_t>(p);
+    t.seconds = (int64_t) read_le<uint64_t>(p + 8);
+    memcpy(target, &t, sizeof(t));
 }
 
-std::string read_string(const unsigned char* p)
+inline std::string read_string(const unsigned char* p)
 {
     uint32_t len = read_le<uint32_t>(p);
     return std::string((const char*)p + 4, len);
 }
 
-double read_le_double(const unsigned char* p)
+inline double read_le_double(const unsigned char* p)
 {
     double a;
     char* b = (char*)(double*)&a;
@@ -40,7 +69,7 @@ double read_le_double(const unsigned char* p)
     memcpy(b, p, sizeof(double));
     return a;
 }
-float read_le_float(const unsigned char* p)
+inline float read_le_float(const unsigned char* p)
 {
     float a;
     char* b = (char*)(float*)&a;
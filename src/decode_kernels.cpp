@@ -0,0 +1,183 @@
+#include <cstdlib>
+#include <atomic>
+#include <mutex>
+
+#include "decode_kernels.hpp"
+#include "log.hpp"
+
+namespace TDMS
+{
+
+size_t numeric_type_size(numeric_type t)
+{
+    switch(t)
+    {
+    case numeric_type::INT8:
+    case numeric_type::UINT8:
+        return 1;
+    case numeric_type::INT16:
+    case numeric_type::UINT16:
+        return 2;
+    case numeric_type::INT32:
+    case numeric_type::UINT32:
+    case numeric_type::FLOAT32:
+        return 4;
+    case numeric_type::INT64:
+    case numeric_type::UINT64:
+    case numeric_type::FLOAT64:
+        return 8;
+    case numeric_type::EXTENDED:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+namespace kernels
+{
+
+// The variants, each compiled from decode_kernels_impl.hpp
+namespace generic { const kernel_table& table(); }
+#if defined(TDMSPP_KERNELS_SSE42)
+namespace sse42 { const kernel_table& table(); }
+#endif
+#if defined(TDMSPP_KERNELS_AVX2)
+namespace avx2 { const kernel_table& table(); }
+#endif
+#if defined(TDMSPP_KERNELS_AVX512)
+namespace avx512 { const kernel_table& table(); }
+#endif
+
+std::vector<const kernel_table*> available()
+{
+    std::vector<const kernel_table*> variants;
+    variants.push_back(&generic::table());
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+#if defined(TDMSPP_KERNELS_SSE42)
+    if(__builtin_cpu_supports("sse4.2"))
+        variants.push_back(&sse42::table());
+#endif
+#if defined(TDMSPP_KERNELS_AVX2)
+    if(__builtin_cpu_supports("avx2"))
+        variants.push_back(&avx2::table());
+#endif
+#if defined(TDMSPP_KERNELS_AVX512)
+    if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+            && __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq"))
+        variants.push_back(&avx512::table());
+#endif
+#endif
+    return variants;
+}
+
+const kernel_table* find_variant(const std::string& name)
+{
+    for(const kernel_table* t : available())
+    {
+        if(name == t->name)
+            return t;
+    }
+    return nullptr;
+}
+
+std::atomic<const kernel_table*> active_table(nullptr);
+
+const kernel_table* detect()
+{
+    const char* requested = std::getenv("TDMSPP_ISA");
+    if(requested != nullptr && *requested != '\0')
+    {
+        const kernel_table* t = find_variant(requested);
+        if(t != nullptr)
+            return t;
+        log::debug << "TDMSPP_ISA=" << requested << " is not available, "
+            "detecting instead" << log::endl;
+    }
+    return available().back();
+}
+
+const kernel_table& active()
+{
+    const kernel_table* t = active_table.load(std::memory_order_acquire);
+    if(t == nullptr)
+    {
+        static std::once_flag detected;
+        std::call_once(detected, []{
+            const kernel_table* expected = nullptr;
+            active_table.compare_exchange_strong(expected, detect());
+            log::debug << "Using " << active_table.load()->name
+                << " decode kernels" << log::endl;
+        });
+        t = active_table.load(std::memory_order_acquire);
+    }
+    return *t;
+}
+
+bool select(const std::string& name)
+{
+    const kernel_table* t = find_variant(name);
+    if(t == nullptr)
+        return false;
+    active_table.store(t, std::memory_order_release);
+    return true;
+}
+
+convert_t converter(numeric_type from, numeric_type to, bool big_endian)
+{
+    if(from == numeric_type::NONE || to == numeric_type::NONE)
+        return nullptr;
+    const kernel_table& t = active();
+    return big_endian ? t.convert_swapped[size_t(from)][size_t(to)]
+        : t.convert[size_t(from)][size_t(to)];
+}
+
+summarize_t summarizer(numeric_type from, bool big_endian)
+{
+    if(from == numeric_type::NONE)
+        return nullptr;
+    const kernel_table& t = active();
+    return big_endian ? t.summarize_swapped[size_t(from)]
+        : t.summarize[size_t(from)];
+}
+
+transpose_t transposer(size_t value_size)
+{
+    switch(value_size)
+    {
+    case 1:
+        return active().transpose[0];
+    case 2:
+        return active().transpose[1];
+    case 4:
+        return active().transpose[2];
+    case 8:
+        return active().transpose[3];
+    default:
+        return nullptr;
+    }
+}
+
+double read_extended(const unsigned char* source)
+{
+    double d;
+    generic::table().convert[size_t(numeric_type::EXTENDED)]
+        [size_t(numeric_type::FLOAT64)](source, 16, &d, 1);
+    return d;
+}
+
+void extended_to_double(const unsigned char* source, size_t stride,
+        double* target, size_t n)
+{
+    active().convert[size_t(numeric_type::EXTENDED)]
+        [size_t(numeric_type::FLOAT64)](source, stride, target, n);
+}
+
+void extract_bits(const unsigned char* source, size_t stride, unsigned bit,
+        double* target, size_t n)
+{
+    active().extract_bits(source, stride, bit, target, n);
+}
+
+}
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace TDMS
+{
+
+// Fixed width numeric types the decode kernels can read and write.
+enum class numeric_type
+{
+    INT8,
+    INT16,
+    INT32,
+    INT64,
+    UINT8,
+    UINT16,
+    UINT32,
+    UINT64,
+    FLOAT32,
+    FLOAT64,
+    // x87 80-bit extended precision, stored in a 16 byte slot.
+    // Only supported as a source type.
+    EXTENDED,
+    NONE
+};
+
+size_t numeric_type_size(numeric_type t);
+
+// Maps C++ sample types to their numeric_type
+template<typename T> struct numeric_type_of;
+template<> struct numeric_type_of<int8_t>   { static const numeric_type value = numeric_type::INT8; };
+template<> struct numeric_type_of<int16_t>  { static const numeric_type value = numeric_type::INT16; };
+template<> struct numeric_type_of<int32_t>  { static const numeric_type value = numeric_type::INT32; };
+template<> struct numeric_type_of<int64_t>  { static const numeric_type value = numeric_type::INT64; };
+template<> struct numeric_type_of<uint8_t>  { static const numeric_type value = numeric_type::UINT8; };
+template<> struct numeric_type_of<uint16_t> { static const numeric_type value = numeric_type::UINT16; };
+template<> struct numeric_type_of<uint32_t> { static const numeric_type value = numeric_type::UINT32; };
+template<> struct numeric_type_of<uint64_t> { static const numeric_type value = numeric_type::UINT64; };
+template<> struct numeric_type_of<float>    { static const numeric_type value = numeric_type::FLOAT32; };
+template<> struct numeric_type_of<double>   { static const numeric_type value = numeric_type::FLOAT64; };
+
+namespace kernels
+{
+
+// Reads n samples of one numeric type, spaced stride bytes apart
+// starting at source, and writes them densely packed as another
+// numeric type to target. A stride larger than the sample size
+// de-interleaves.
+typedef void (*convert_t)(const unsigned char* source, size_t stride,
+        void* target, size_t n);
+
+// Extracts one bit out of bytes spaced stride apart, as 0.0 or 1.0.
+typedef void (*extract_bits_t)(const unsigned char* source, size_t stride,
+        unsigned bit, double* target, size_t n);
+
+// Running minimum, maximum and sum of samples read as doubles
+struct summary
+{
+    double min;
+    double max;
+    double sum;
+};
+
+// Adds n samples of one numeric type, spaced stride bytes apart, to s.
+// NaNs are left out of the minimum and maximum, but not the sum.
+typedef void (*summarize_t)(const unsigned char* source, size_t stride,
+        size_t n, summary* s);
+
+// Turns columns values of one size, each a run of rows samples, into
+// rows runs of columns samples.
+typedef void (*transpose_t)(const void* source, size_t rows, size_t columns,
+        void* target);
+
+const size_t numeric_type_count = size_t(numeric_type::NONE);
+
+// One instruction set variant of all decode kernels
+struct kernel_table
+{
+    const char* name;
+    // Indexed [from][to], for little and big endian sources.
+    // Entries with EXTENDED as target are nullptr.
+    convert_t convert[numeric_type_count][numeric_type_count];
+    convert_t convert_swapped[numeric_type_count][numeric_type_count];
+    extract_bits_t extract_bits;
+    summarize_t summarize[numeric_type_count];
+    summarize_t summarize_swapped[numeric_type_count];
+    // For samples of 1, 2, 4 and 8 bytes
+    transpose_t transpose[4];
+};
+
+// The kernels in use. On first use, the best variant the CPU supports
+// is picked, unless the TDMSPP_ISA environment variable names another
+// one ("generic", "sse4.2", "avx2" or "avx512").
+const kernel_table& active();
+
+// Variants compiled in that this CPU can run, worst first
+std::vector<const kernel_table*> available();
+
+// Switches the active kernels. Returns false, without switching, if the
+// variant isn't available.
+bool select(const std::string& name);
+
+// Returns nullptr if either type is NONE, or if the target is EXTENDED.
+convert_t converter(numeric_type from, numeric_type to,
+        bool big_endian = false);
+
+// Returns nullptr if the type is NONE.
+summarize_t summarizer(numeric_type from, bool big_endian = false);
+
+// Returns nullptr unless value_size is 1, 2, 4 or 8.
+transpose_t transposer(size_t value_size);
+
+// Converts one little endian 80-bit extended precision value to the
+// nearest double, without relying on long double being 80-bit.
+double read_extended(const unsigned char* source);
+
+// Bulk version of read_extended.
+void extended_to_double(const unsigned char* source, size_t stride,
+        double* target, size_t n);
+
+// Used for DAQmx digital line scalers.
+void extract_bits(const unsigned char* source, size_t stride, unsigned bit,
+        double* target, size_t n);
+
+}
+}
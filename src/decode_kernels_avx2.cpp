@@ -0,0 +1,3 @@
+#define TDMS_KERNELS_ISA avx2
+#define TDMS_KERNELS_ISA_NAME "avx2"
+#include "decode_kernels_impl.hpp"
@@ -0,0 +1,3 @@
+#define TDMS_KERNELS_ISA avx512
+#define TDMS_KERNELS_ISA_NAME "avx512"
+#include "decode_kernels_impl.hpp"
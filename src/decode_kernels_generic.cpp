@@ -0,0 +1,3 @@
+#define TDMS_KERNELS_ISA generic
+#define TDMS_KERNELS_ISA_NAME "generic"
+#include "decode_kernels_impl.hpp"
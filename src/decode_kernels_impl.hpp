@@ -0,0 +1,499 @@
+// Decode kernels, compiled once per instruction set variant.
+//
+// Include this from a translation unit that defines TDMS_KERNELS_ISA to
+// the namespace of the variant, and TDMS_KERNELS_ISA_NAME to its name.
+// Everything lives in that namespace, so the differently compiled copies
+// never get merged by the linker. For the same reason only builtins are
+// used here and no inline functions or templates from the standard library.
+#include <cstring>
+#include <cstdint>
+
+#include "decode_kernels.hpp"
+
+#if !defined(TDMS_KERNELS_ISA) || !defined(TDMS_KERNELS_ISA_NAME)
+#error "Define TDMS_KERNELS_ISA and TDMS_KERNELS_ISA_NAME before including decode_kernels_impl.hpp"
+#endif
+
+namespace TDMS
+{
+namespace kernels
+{
+namespace TDMS_KERNELS_ISA
+{
+
+inline uint8_t swap_bytes(uint8_t v)
+{
+    return v;
+}
+inline uint16_t swap_bytes(uint16_t v)
+{
+    return uint16_t((v >> 8) | (v << 8));
+}
+inline uint32_t swap_bytes(uint32_t v)
+{
+    return ((v & 0x000000FFu) << 24) | ((v & 0x0000FF00u) << 8)
+        | ((v & 0x00FF0000u) >> 8) | ((v & 0xFF000000u) >> 24);
+}
+inline uint64_t swap_bytes(uint64_t v)
+{
+    return (uint64_t(swap_bytes(uint32_t(v))) << 32)
+        | swap_bytes(uint32_t(v >> 32));
+}
+
+template<size_t N> struct unsigned_of;
+template<> struct unsigned_of<1> { typedef uint8_t type; };
+template<> struct unsigned_of<2> { typedef uint16_t type; };
+template<> struct unsigned_of<4> { typedef uint32_t type; };
+template<> struct unsigned_of<8> { typedef uint64_t type; };
+
+// Loads one sample, byte swapping it for big endian sources
+template<typename S, bool Swap>
+inline S load(const unsigned char* p)
+{
+    S v;
+    if(Swap)
+    {
+        typename unsigned_of<sizeof(S)>::type u;
+        memcpy(&u, p, sizeof(S));
+        u = swap_bytes(u);
+        memcpy(&v, &u, sizeof(S));
+    }
+    else
+    {
+        memcpy(&v, p, sizeof(S));
+    }
+    return v;
+}
+
+inline int count_leading_zeros(uint64_t v)
+{
+#if defined(__GNUC__)
+    return __builtin_clzll(v);
+#else
+    int n = 0;
+    for(uint64_t bit = uint64_t(1) << 63; (v & bit) == 0; bit >>= 1)
+        ++n;
+    return n;
+#endif
+}
+
+inline double bits_to_double(uint64_t bits)
+{
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+// Rounds the mantissa right by shift bits, to nearest with ties to even.
+inline uint64_t round_shift(uint64_t mantissa, int shift)
+{
+    if(shift >= 64)
+    {
+        // Only a mantissa above one half of the last place rounds up
+        return (shift == 64 && mantissa > (uint64_t(1) << 63)) ? 1 : 0;
+    }
+    uint64_t result = mantissa >> shift;
+    uint64_t remainder = mantissa & ((uint64_t(1) << shift) - 1);
+    uint64_t half = uint64_t(1) << (shift - 1);
+    if(remainder > half || (remainder == half && (result & 1)))
+        ++result;
+    return result;
+}
+
+inline double read_extended(const unsigned char* source)
+{
+    uint64_t mantissa;
+    memcpy(&mantissa, source, 8);
+    uint16_t sign_exponent = uint16_t(source[8] | (source[9] << 8));
+    uint64_t sign = uint64_t(sign_exponent >> 15) << 63;
+    int exponent = sign_exponent & 0x7FFF;
+
+    // Fast path: normalised value that fits the double exponent range.
+    // Dropping 11 bits of the explicit 64-bit mantissa leaves the 53 bits
+    // of a double including the hidden bit.
+    int biased = exponent - 16383 + 1023;
+    if((mantissa >> 63) && biased > 0 && biased < 2047)
+    {
+        uint64_t m = round_shift(mantissa, 11);
+        // Rounding may carry into the next binade, which the addition of
+        // the exponent below absorbs; it overflows into infinity correctly.
+        uint64_t bits = (uint64_t(biased - 1) << 52) + m;
+        return bits_to_double(sign | bits);
+    }
+
+    // Without the explicit integer bit only zero exponents are valid;
+    // x87 treats such unnormals as invalid operands.
+    if(exponent != 0 && (mantissa >> 63) == 0)
+        return bits_to_double(sign | 0x7FF8000000000000ULL);
+    if(exponent == 0x7FFF)
+    {
+        if((mantissa << 1) == 0)
+            return bits_to_double(sign | 0x7FF0000000000000ULL);
+        // Keep the payload top bits, and make sure it stays a NaN
+        return bits_to_double(sign | 0x7FF8000000000000ULL
+                | ((mantissa << 1) >> 12));
+    }
+    if(mantissa == 0)
+        return bits_to_double(sign);
+
+    // Denormal input, or out of range for a double:
+    // normalise the mantissa first.
+    int lz = count_leading_zeros(mantissa);
+    mantissa <<= lz;
+    biased = (exponent == 0 ? 1 : exponent) - 16383 + 1023 - lz;
+    if(biased >= 2047)
+        return bits_to_double(sign | 0x7FF0000000000000ULL);
+    if(biased > 0)
+    {
+        uint64_t bits = (uint64_t(biased - 1) << 52) + round_shift(mantissa, 11);
+        return bits_to_double(sign | bits);
+    }
+    // Subnormal double; a carry out of the mantissa yields the smallest
+    // normal number, which is the right encoding.
+    return bits_to_double(sign | round_shift(mantissa, 12 - biased));
+}
+
+// Range of the integer sample types
+template<typename T> struct integer_limits
+{
+    static const bool is_integer = false;
+};
+template<> struct integer_limits<int8_t>
+{
+    static const bool is_integer = true;
+    static const int8_t low = -128, high = 127;
+};
+template<> struct integer_limits<int16_t>
+{
+    static const bool is_integer = true;
+    static const int16_t low = -32768, high = 32767;
+};
+template<> struct integer_limits<int32_t>
+{
+    static const bool is_integer = true;
+    static const int32_t low = -2147483647 - 1, high = 2147483647;
+};
+template<> struct integer_limits<int64_t>
+{
+    static const bool is_integer = true;
+    static const int64_t low = -9223372036854775807LL - 1,
+                 high = 9223372036854775807LL;
+};
+template<> struct integer_limits<uint8_t>
+{
+    static const bool is_integer = true;
+    static const uint8_t low = 0, high = 0xFF;
+};
+template<> struct integer_limits<uint16_t>
+{
+    static const bool is_integer = true;
+    static const uint16_t low = 0, high = 0xFFFF;
+};
+template<> struct integer_limits<uint32_t>
+{
+    static const bool is_integer = true;
+    static const uint32_t low = 0, high = 0xFFFFFFFFu;
+};
+template<> struct integer_limits<uint64_t>
+{
+    static const bool is_integer = true;
+    static const uint64_t low = 0, high = 0xFFFFFFFFFFFFFFFFULL;
+};
+
+template<typename D, typename S, bool Saturate>
+struct sample_cast
+{
+    static D apply(S v)
+    {
+        return D(v);
+    }
+};
+
+// Floating point values that are NaN or out of the range of an integer
+// target would be undefined behaviour to cast, so they saturate to the
+// nearest integer value, NaN to 0.
+template<typename D, typename S>
+struct sample_cast<D, S, true>
+{
+    static D apply(S v)
+    {
+        typedef integer_limits<D> limits;
+        // 2^digits, the first value above high, is exact in every float type
+        const S limit = S(limits::high/2 + 1) * S(2);
+        return v != v ? D(0)
+            : v <= S(limits::low) ? D(limits::low)
+            : v >= limit ? D(limits::high)
+            : D(v);
+    }
+};
+
+// Converts one sample to the target type
+template<typename D, typename S>
+inline D cast(S v)
+{
+    return sample_cast<D, S, integer_limits<D>::is_integer
+        && !integer_limits<S>::is_integer>::apply(v);
+}
+
+template<bool Swap>
+inline double load_extended(const unsigned char* p)
+{
+    if(!Swap)
+        return read_extended(p);
+    unsigned char reversed[16];
+    for(int i = 0; i < 16; ++i)
+        reversed[i] = p[15 - i];
+    return read_extended(reversed);
+}
+
+template<typename D, bool Swap>
+void convert_extended(const unsigned char* __restrict source, size_t stride,
+        void* __restrict target, size_t n)
+{
+    D* __restrict out = static_cast<D*>(target);
+    for(size_t i = 0; i < n; ++i)
+    {
+        out[i] = cast<D>(load_extended<Swap>(source + i*stride));
+    }
+}
+
+template<typename S, typename D, bool Swap>
+void convert(const unsigned char* __restrict source, size_t stride,
+        void* __restrict target, size_t n)
+{
+    D* __restrict out = static_cast<D*>(target);
+    if(stride == sizeof(S))
+    {
+        // Dense input: a plain widening/narrowing loop the compiler
+        // turns into packed loads, shuffles and conversions.
+        for(size_t i = 0; i < n; ++i)
+        {
+            out[i] = cast<D>(load<S, Swap>(source + i*sizeof(S)));
+        }
+        return;
+    }
+    // Interleaved input: gather in blocks so the conversion and the
+    // stores still run packed.
+    const size_t block = 16;
+    size_t i = 0;
+    for(; i + block <= n; i += block)
+    {
+        S tmp[block];
+        for(size_t j = 0; j < block; ++j)
+            tmp[j] = load<S, Swap>(source + (i + j)*stride);
+        for(size_t j = 0; j < block; ++j)
+            out[i + j] = cast<D>(tmp[j]);
+    }
+    for(; i < n; ++i)
+    {
+        out[i] = cast<D>(load<S, Swap>(source + i*stride));
+    }
+}
+
+template<typename S, bool Swap>
+void copy(const unsigned char* __restrict source, size_t stride,
+        void* __restrict target, size_t n)
+{
+    if(!Swap && stride == sizeof(S))
+    {
+        memcpy(target, source, n*sizeof(S));
+        return;
+    }
+    convert<S, S, Swap>(source, stride, target, n);
+}
+
+void extract_bits(const unsigned char* __restrict source, size_t stride,
+        unsigned bit, double* __restrict target, size_t n)
+{
+    for(size_t i = 0; i < n; ++i)
+    {
+        target[i] = double((source[i*stride] >> bit) & 1);
+    }
+}
+
+// Min, max and sum in one pass over the raw samples. Every lane keeps
+// its own partial results, so the loop runs packed without reordering
+// the additions of a lane.
+template<typename S, bool Swap>
+void summarize(const unsigned char* __restrict source, size_t stride,
+        size_t n, summary* s)
+{
+    const size_t lanes = 8;
+    double lo[lanes], hi[lanes], sum[lanes];
+    for(size_t j = 0; j < lanes; ++j)
+    {
+        lo[j] = s->min;
+        hi[j] = s->max;
+        sum[j] = 0;
+    }
+    size_t i = 0;
+    for(; i + lanes <= n; i += lanes)
+    {
+        for(size_t j = 0; j < lanes; ++j)
+        {
+            double v = double(load<S, Swap>(source + (i + j)*stride));
+            lo[j] = v < lo[j] ? v : lo[j];
+            hi[j] = v > hi[j] ? v : hi[j];
+            sum[j] += v;
+        }
+    }
+    for(; i < n; ++i)
+    {
+        double v = double(load<S, Swap>(source + i*stride));
+        lo[0] = v < lo[0] ? v : lo[0];
+        hi[0] = v > hi[0] ? v : hi[0];
+        sum[0] += v;
+    }
+    for(size_t j = 0; j < lanes; ++j)
+    {
+        s->min = lo[j] < s->min ? lo[j] : s->min;
+        s->max = hi[j] > s->max ? hi[j] : s->max;
+        s->sum += sum[j];
+    }
+}
+
+template<bool Swap>
+void summarize_extended(const unsigned char* __restrict source, size_t stride,
+        size_t n, summary* s)
+{
+    for(size_t i = 0; i < n; ++i)
+    {
+        double v = load_extended<Swap>(source + i*stride);
+        s->min = v < s->min ? v : s->min;
+        s->max = v > s->max ? v : s->max;
+        s->sum += v;
+    }
+}
+
+template<typename S>
+summarize_t pick_summarize(bool swap)
+{
+    return swap ? &summarize<S, true> : &summarize<S, false>;
+}
+
+void fill_summarize(summarize_t* row, bool swap)
+{
+    row[size_t(numeric_type::INT8)]    = pick_summarize<int8_t>(swap);
+    row[size_t(numeric_type::INT16)]   = pick_summarize<int16_t>(swap);
+    row[size_t(numeric_type::INT32)]   = pick_summarize<int32_t>(swap);
+    row[size_t(numeric_type::INT64)]   = pick_summarize<int64_t>(swap);
+    row[size_t(numeric_type::UINT8)]   = pick_summarize<uint8_t>(swap);
+    row[size_t(numeric_type::UINT16)]  = pick_summarize<uint16_t>(swap);
+    row[size_t(numeric_type::UINT32)]  = pick_summarize<uint32_t>(swap);
+    row[size_t(numeric_type::UINT64)]  = pick_summarize<uint64_t>(swap);
+    row[size_t(numeric_type::FLOAT32)] = pick_summarize<float>(swap);
+    row[size_t(numeric_type::FLOAT64)] = pick_summarize<double>(swap);
+    row[size_t(numeric_type::EXTENDED)] = swap ? &summarize_extended<true>
+        : &summarize_extended<false>;
+}
+
+// Columns of rows samples each, one after the other, to rows of
+// columns samples. Goes tile by tile so both sides stay in cache.
+template<typename S>
+void transpose(const void* __restrict source, size_t rows, size_t columns,
+        void* __restrict target)
+{
+    const S* in = static_cast<const S*>(source);
+    S* out = static_cast<S*>(target);
+    if(columns == 1)
+    {
+        memcpy(target, source, rows*sizeof(S));
+        return;
+    }
+    const size_t tile = 16;
+    for(size_t r0 = 0; r0 < rows; r0 += tile)
+    {
+        size_t r1 = r0 + tile < rows ? r0 + tile : rows;
+        for(size_t c0 = 0; c0 < columns; c0 += tile)
+        {
+            size_t c1 = c0 + tile < columns ? c0 + tile : columns;
+            for(size_t r = r0; r < r1; ++r)
+            {
+                for(size_t c = c0; c < c1; ++c)
+                    out[r*columns + c] = in[c*rows + r];
+            }
+        }
+    }
+}
+
+template<typename S, typename D>
+struct pick
+{
+    static convert_t get(bool swap)
+    {
+        return swap ? &convert<S, D, true> : &convert<S, D, false>;
+    }
+};
+template<typename S>
+struct pick<S, S>
+{
+    static convert_t get(bool swap)
+    {
+        return swap ? &copy<S, true> : &copy<S, false>;
+    }
+};
+template<typename D>
+struct pick<void, D>
+{
+    static convert_t get(bool swap)
+    {
+        return swap ? &convert_extended<D, true> : &convert_extended<D, false>;
+    }
+};
+
+template<typename S>
+void fill_row(convert_t* row, bool swap)
+{
+    row[size_t(numeric_type::INT8)]    = pick<S, int8_t>::get(swap);
+    row[size_t(numeric_type::INT16)]   = pick<S, int16_t>::get(swap);
+    row[size_t(numeric_type::INT32)]   = pick<S, int32_t>::get(swap);
+    row[size_t(numeric_type::INT64)]   = pick<S, int64_t>::get(swap);
+    row[size_t(numeric_type::UINT8)]   = pick<S, uint8_t>::get(swap);
+    row[size_t(numeric_type::UINT16)]  = pick<S, uint16_t>::get(swap);
+    row[size_t(numeric_type::UINT32)]  = pick<S, uint32_t>::get(swap);
+    row[size_t(numeric_type::UINT64)]  = pick<S, uint64_t>::get(swap);
+    row[size_t(numeric_type::FLOAT32)] = pick<S, float>::get(swap);
+    row[size_t(numeric_type::FLOAT64)] = pick<S, double>::get(swap);
+    row[size_t(numeric_type::EXTENDED)] = nullptr;
+}
+
+void fill_rows(convert_t (*rows)[numeric_type_count], bool swap)
+{
+    fill_row<int8_t>(rows[size_t(numeric_type::INT8)], swap);
+    fill_row<int16_t>(rows[size_t(numeric_type::INT16)], swap);
+    fill_row<int32_t>(rows[size_t(numeric_type::INT32)], swap);
+    fill_row<int64_t>(rows[size_t(numeric_type::INT64)], swap);
+    fill_row<uint8_t>(rows[size_t(numeric_type::UINT8)], swap);
+    fill_row<uint16_t>(rows[size_t(numeric_type::UINT16)], swap);
+    fill_row<uint32_t>(rows[size_t(numeric_type::UINT32)], swap);
+    fill_row<uint64_t>(rows[size_t(numeric_type::UINT64)], swap);
+    fill_row<float>(rows[size_t(numeric_type::FLOAT32)], swap);
+    fill_row<double>(rows[size_t(numeric_type::FLOAT64)], swap);
+    fill_row<void>(rows[size_t(numeric_type::EXTENDED)], swap);
+}
+
+kernel_table make_table()
+{
+    kernel_table t;
+    t.name = TDMS_KERNELS_ISA_NAME;
+    fill_rows(t.convert, false);
+    fill_rows(t.convert_swapped, true);
+    t.extract_bits = &extract_bits;
+    fill_summarize(t.summarize, false);
+    fill_summarize(t.summarize_swapped, true);
+    t.transpose[0] = &transpose<uint8_t>;
+    t.transpose[1] = &transpose<uint16_t>;
+    t.transpose[2] = &transpose<uint32_t>;
+    t.transpose[3] = &transpose<uint64_t>;
+    return t;
+}
+
+const kernel_table& table()
+{
+    static const kernel_table t = make_table();
+    return t;
+}
+
+}
+}
+}
@@ -0,0 +1,3 @@
+#define TDMS_KERNELS_ISA sse42
+#define TDMS_KERNELS_ISA_NAME "sse4.2"
+#include "decode_kernels_impl.hpp"
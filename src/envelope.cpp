@@ -0,0 +1,232 @@
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <mutex>
+#include <exception>
+
+#include "envelope.hpp"
+
+namespace TDMS
+{
+
+// Walks the extents of an object over a range of values
+class envelope_builder
+{
+public:
+    envelope_builder(const object* o, size_t start, size_t count,
+            size_t buckets)
+        : _object(o),
+          _start(start),
+          _count(count),
+          _buckets(buckets)
+    {
+    }
+
+    size_t bound(size_t b) const
+    {
+        return _start + size_t(uint64_t(b) * _count / _buckets);
+    }
+
+    size_t bucket_of(size_t value) const
+    {
+        size_t b = size_t(uint64_t(value - _start) * _buckets / _count);
+        while(b + 1 < _buckets && bound(b + 1) <= value)
+            ++b;
+        while(b > 0 && bound(b) > value)
+            --b;
+        return b;
+    }
+
+    // Summarizes the values [from, to) into out, which holds the
+    // buckets from bucket_of(from) on
+    void run(size_t from, size_t to, envelope_bucket* out) const
+    {
+        const object_table& table = *_object->_table;
+        uint32_t row = _object->_index;
+        array_view<object::extent> extents = table._extents_of(row);
+        size_t x = table._extent_at(row, from);
+        size_t offset = from - table._extent_starts[table._extent_ranges[row].begin + x];
+        size_t first_bucket = bucket_of(from);
+        size_t value = from;
+        while(value < to && x < extents.size())
+        {
+            const object::extent& e = extents[x];
+            // Objects can be listed with no values in a segment
+            if(e.number_values == 0)
+            {
+                ++x;
+                continue;
+            }
+            size_t b = bucket_of(value);
+            size_t end = std::min(std::min(to, bound(b + 1)),
+                    value + (e.number_values - offset));
+            _add(e, offset, end - value, out[b - first_bucket]);
+            offset += end - value;
+            value = end;
+            if(offset == e.number_values)
+            {
+                ++x;
+                offset = 0;
+            }
+        }
+    }
+private:
+    void _add(const object::extent& e, size_t offset, size_t n,
+            envelope_bucket& bucket) const
+    {
+        const unsigned char* source = e.data + offset*e.stride;
+        kernels::summary s = {bucket.min, bucket.max, 0};
+        double first = std::numeric_limits<double>::quiet_NaN();
+        double last = first;
+        if(e.bit >= 0)
+        {
+            // Digital lines go through a small buffer of doubles
+            kernels::summarize_t summarize = kernels::summarizer(
+                    numeric_type::FLOAT64);
+            const size_t block = 256;
+            double tmp[block];
+            for(size_t i = 0; i < n; i += block)
+            {
+                size_t m = std::min(block, n - i);
+                kernels::extract_bits(source + i*e.stride, e.stride, e.bit,
+                        tmp, m);
+                if(i == 0)
+                    first = tmp[0];
+                last = tmp[m - 1];
+                summarize((const unsigned char*) tmp, sizeof(double), m, &s);
+            }
+        }
+        else
+        {
+            kernels::summarize_t summarize = kernels::summarizer(e.type,
+                    e.big_endian);
+            kernels::convert_t convert = kernels::converter(e.type,
+                    numeric_type::FLOAT64, e.big_endian);
+            if(summarize == nullptr)
+            {
+                throw std::runtime_error("Object " + _object->get_path()
+                        + " doesn't hold numeric data");
+            }
+            summarize(source, e.stride, n, &s);
+            convert(source, e.stride, &first, 1);
+            convert(source + (n - 1)*e.stride, e.stride, &last, 1);
+        }
+        if(bucket.count == 0)
+            bucket.first = first;
+        bucket.last = last;
+        bucket.min = s.min;
+        bucket.max = s.max;
+        // The mean holds the sum until the buckets are complete
+        bucket.mean += s.sum;
+        bucket.count += n;
+    }
+
+    const object* _object;
+    size_t _start;
+    size_t _count;
+    size_t _buckets;
+};
+
+namespace
+{
+
+envelope_bucket empty_bucket()
+{
+    envelope_bucket b;
+    b.min = std::numeric_limits<double>::infinity();
+    b.max = -std::numeric_limits<double>::infinity();
+    b.first = b.last = std::numeric_limits<double>::quiet_NaN();
+    b.mean = 0;
+    b.count = 0;
+    return b;
+}
+
+void merge(envelope_bucket& into, const envelope_bucket& b)
+{
+    if(b.count == 0)
+        return;
+    if(into.count == 0)
+        into.first = b.first;
+    into.last = b.last;
+    into.min = std::min(into.min, b.min);
+    into.max = std::max(into.max, b.max);
+    into.mean += b.mean;
+    into.count += b.count;
+}
+
+// Values per thread below which starting one isn't worth it
+const size_t min_values_per_thread = 1 << 20;
+
+}
+
+std::vector<envelope_bucket> envelope(const object* o, size_t start,
+        size_t count, size_t buckets, unsigned threads)
+{
+    size_t number_values = o->number_values();
+    if(start > number_values)
+    {
+        throw std::out_of_range("Reading past the end of object " + o->get_path());
+    }
+    if(o->_table->_flags[o->_index] & object_table::SKIPPED)
+    {
+        throw std::runtime_error("Object " + o->get_path()
+                + " wasn't selected when opening");
+    }
+    count = std::min(count, number_values - start);
+    buckets = std::min(buckets, count);
+    if(buckets == 0)
+        return std::vector<envelope_bucket>();
+
+    envelope_builder builder(o, start, count, buckets);
+    if(threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = unsigned(std::min<size_t>(threads,
+                std::max<size_t>(1, count / min_values_per_thread)));
+
+    // Every thread takes an equal share of the values, and summarizes
+    // the buckets it touches; shared buckets are merged afterwards.
+    std::vector<envelope_bucket> result(buckets, empty_bucket());
+    std::vector<std::vector<envelope_bucket>> partial(threads);
+    std::vector<std::thread> workers;
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    for(unsigned t = 0; t < threads; ++t)
+    {
+        size_t from = start + size_t(uint64_t(t) * count / threads);
+        size_t to = start + size_t(uint64_t(t + 1) * count / threads);
+        partial[t].assign(builder.bucket_of(to - 1) - builder.bucket_of(from) + 1,
+                empty_bucket());
+        auto work = [&builder, &partial, &error, &error_mutex, t, from, to](){
+            try
+            {
+                builder.run(from, to, partial[t].data());
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                error = std::current_exception();
+            }
+        };
+        if(t + 1 == threads)
+            work();
+        else
+            workers.emplace_back(work);
+    }
+    for(std::thread& w : workers)
+        w.join();
+    if(error)
+        std::rethrow_exception(error);
+
+    for(unsigned t = 0; t < threads; ++t)
+    {
+        size_t first = builder.bucket_of(start + size_t(uint64_t(t) * count / threads));
+        for(size_t b = 0; b < partial[t].size(); ++b)
+            merge(result[first + b], partial[t][b]);
+    }
+    for(envelope_bucket& b : result)
+        b.mean /= double(b.count);
+    return result;
+}
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+
+#include "tdms.hpp"
+
+namespace TDMS
+{
+
+// Statistics of one bucket of values, for plotting a channel at a
+// resolution far below its number of values
+struct envelope_bucket
+{
+    double min;
+    double max;
+    double first;
+    double last;
+    double mean;
+    size_t count;
+};
+
+// Splits count values of o, from start on, into buckets of (nearly)
+// equal size and summarizes each one in a single pass over the raw
+// segment data, without decoding the channel. The range is split over
+// up to threads threads, all cores for 0. Returns fewer buckets when
+// there are fewer values. NaNs are left out of min and max.
+std::vector<envelope_bucket> envelope(const object* o, size_t start,
+        size_t count, size_t buckets, unsigned threads = 0);
+
+}
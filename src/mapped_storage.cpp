@@ -0,0 +1,193 @@
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "mapped_storage.hpp"
+#include "log.hpp"
+
+namespace TDMS
+{
+
+namespace
+{
+
+// FNV-1a, to get short file names out of paths
+uint64_t hash(const std::string& s, uint64_t h = 14695981039346656037ULL)
+{
+    for(unsigned char c : s)
+    {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+std::string hex(uint64_t v)
+{
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long) v);
+    return buf;
+}
+
+}
+
+#if !defined(_WIN32)
+
+mapped_allocator::mapped_allocator(const std::string& directory,
+        const std::string& source, bool keep)
+    : _keep(keep)
+{
+    struct stat st;
+    if(stat(directory.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+    {
+        throw std::runtime_error("Decode directory \"" + directory
+                + "\" doesn't exist");
+    }
+    if(stat(source.c_str(), &st) != 0)
+    {
+        throw std::runtime_error("File \"" + source + "\" could not be read");
+    }
+    // A changed source file gets new names, old files are left alone
+    uint64_t h = hash(source);
+    h = hash(std::to_string(st.st_size), h);
+    h = hash(std::to_string(st.st_mtime), h);
+    _prefix = directory + "/tdmspp-" + hex(h) + "-";
+}
+
+mapped_allocator::~mapped_allocator()
+{
+}
+
+void* mapped_allocator::allocate(const object& o, size_t bytes)
+{
+    // The same file opened with another block size has other blocks,
+    // so they are named by the values they hold
+    const object::block& b = o.blocks()[_block_counts[&o]++];
+    mapping m;
+    m.name = _prefix + hex(hash(o.get_path())) + "-"
+        + std::to_string(b.first_value) + "-"
+        + std::to_string(b.number_values) + ".bin";
+    m.reused = false;
+    m.complete = false;
+
+    // Only complete files carry the final name
+    int fd = -1;
+    if(_keep)
+    {
+        fd = open(m.name.c_str(), O_RDWR);
+        struct stat st;
+        if(fd >= 0 && (fstat(fd, &st) != 0 || size_t(st.st_size) != bytes))
+        {
+            close(fd);
+            fd = -1;
+        }
+        m.reused = (fd >= 0);
+    }
+    if(fd < 0)
+    {
+        std::string partial = m.name + ".partial";
+        fd = open(partial.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0)
+        {
+            throw std::runtime_error("Could not create \"" + partial + "\": "
+                    + strerror(errno));
+        }
+        if(ftruncate(fd, bytes) != 0)
+        {
+            close(fd);
+            unlink(partial.c_str());
+            throw std::runtime_error("Could not size \"" + partial + "\": "
+                    + strerror(errno));
+        }
+    }
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(p == MAP_FAILED)
+    {
+        if(!m.reused)
+            unlink((m.name + ".partial").c_str());
+        throw std::runtime_error("Could not map \"" + m.name + "\"");
+    }
+    log::debug << (m.reused ? "Reusing " : "Decoding into ") << m.name << log::endl;
+    m.complete = m.reused;
+    _mappings[p] = m;
+    return p;
+}
+
+void mapped_allocator::deallocate(const object&, void* data, size_t bytes)
+{
+    auto it = _mappings.find(data);
+    if(it == _mappings.end())
+        return;
+    const mapping& m = it->second;
+    munmap(data, bytes);
+    if(!m.reused)
+    {
+        std::string partial = m.name + ".partial";
+        if(_keep && m.complete)
+            rename(partial.c_str(), m.name.c_str());
+        else
+            unlink(partial.c_str());
+    }
+    else if(!_keep)
+    {
+        unlink(m.name.c_str());
+    }
+    _mappings.erase(it);
+}
+
+bool mapped_allocator::holds_values(const object&, const void* data)
+{
+    auto it = _mappings.find(data);
+    return it != _mappings.end() && it->second.reused;
+}
+
+void mapped_allocator::commit()
+{
+    for(auto& m : _mappings)
+        m.second.complete = true;
+}
+
+#else
+
+mapped_allocator::mapped_allocator(const std::string&, const std::string&,
+        bool)
+    : _keep(false)
+{
+    throw std::runtime_error("Decoding into mapped files is not supported "
+            "on this platform");
+}
+
+mapped_allocator::~mapped_allocator()
+{
+}
+
+void* mapped_allocator::allocate(const object&, size_t)
+{
+    return nullptr;
+}
+
+void mapped_allocator::deallocate(const object&, void*, size_t)
+{
+}
+
+bool mapped_allocator::holds_values(const object&, const void*)
+{
+    return false;
+}
+
+void mapped_allocator::commit()
+{
+}
+
+#endif
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <map>
+#include <cstdint>
+
+#include "tdms.hpp"
+
+namespace TDMS
+{
+
+// Decodes objects into memory mapped files in a directory, one per block,
+// so decoded data is backed by disk instead of swap. The files are
+// removed when released, unless they are kept: then they are named after
+// the source file, its size and modification time and the values of the
+// block, and picked up again the next time the same file is opened.
+class mapped_allocator : public data_allocator
+{
+public:
+    mapped_allocator(const std::string& directory, const std::string& source,
+            bool keep);
+    ~mapped_allocator();
+
+    void* allocate(const object& o, size_t bytes) override;
+    void deallocate(const object& o, void* data, size_t bytes) override;
+    bool holds_values(const object& o, const void* data) override;
+
+    // All blocks allocated so far hold their decoded values
+    void commit();
+private:
+    struct mapping
+    {
+        std::string name;
+        bool reused;
+        bool complete;
+    };
+
+    std::string _prefix;
+    bool _keep;
+    // Blocks handed out per object, to know which one is allocated next
+    std::map<const object*, size_t> _block_counts;
+    std::map<const void*, mapping> _mappings;
+};
+
+}
@@ -0,0 +1,390 @@
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <new>
+
+#include "tdms.hpp"
+
+namespace TDMS
+{
+
+namespace
+{
+
+const uint32_t no_block = std::numeric_limits<uint32_t>::max();
+const uint32_t no_row = std::numeric_limits<uint32_t>::max();
+const string_ref wf_start_time("wf_start_time", 13);
+const string_ref root_path("/", 1);
+
+// Stable counting sort of items by their row, into one array with a
+// range per row
+template<typename T, typename R>
+void group(const std::vector<std::pair<uint32_t, T>>& items, size_t rows,
+        arena_vector<T>& out, arena_vector<R>& ranges)
+{
+    ranges.assign(rows, R{0, 0});
+    for(auto& item : items)
+        ++ranges[item.first].count;
+    uint32_t begin = 0;
+    for(R& r : ranges)
+    {
+        r.begin = begin;
+        begin += r.count;
+    }
+    out.resize(items.size());
+    std::vector<uint32_t> next(rows);
+    for(size_t i = 0; i < rows; ++i)
+        next[i] = ranges[i].begin;
+    for(auto& item : items)
+        out[next[item.first]++] = item.second;
+}
+
+// Splits a path into the path of its parent and the name of its last
+// part, still escaped. Every part is /'name', with '' for a quote in
+// the name. False for paths that don't follow that.
+bool split_path(string_ref path, string_ref& parent, string_ref& name)
+{
+    const char* p = path.data;
+    const char* end = p + path.size;
+    const char* last = nullptr;
+    if(p == end)
+        return false;
+    while(p != end)
+    {
+        if(*p != '/' || p + 1 == end || p[1] != '\'')
+            return false;
+        last = p;
+        p += 2;
+        while(true)
+        {
+            if(p == end)
+                return false;
+            if(*p == '\'' && (p + 1 == end || p[1] != '\''))
+                break;
+            p += (*p == '\'') ? 2 : 1;
+        }
+        ++p;
+    }
+    parent = (last == path.data) ? root_path
+        : string_ref(path.data, last - path.data);
+    name = string_ref(last + 2, end - last - 3);
+    return true;
+}
+
+}
+
+object_table::object_table(arena* a, channel_cache* cache)
+    : _arena(a),
+      _cache(cache),
+      _allocator(nullptr),
+      _paths(arena_allocator<string_ref>(a)),
+      _types(arena_allocator<const data_type_t*>(a)),
+      _number_values(arena_allocator<uint64_t>(a)),
+      _flags(arena_allocator<uint8_t>(a)),
+      _property_ranges(arena_allocator<range>(a)),
+      _block_ranges(arena_allocator<range>(a)),
+      _extent_ranges(arena_allocator<range>(a)),
+      _start_time_ranges(arena_allocator<range>(a)),
+      _properties(arena_allocator<property_entry>(a)),
+      _start_times(arena_allocator<start_time>(a)),
+      _blocks(arena_allocator<object::block>(a)),
+      _extents(arena_allocator<object::extent>(a)),
+      _extent_starts(arena_allocator<uint64_t>(a)),
+      _regular_extents(arena_allocator<uint64_t>(a)),
+      _handles(nullptr),
+      _by_path(arena_allocator<uint32_t>(a)),
+      _names(arena_allocator<string_ref>(a)),
+      _parents(arena_allocator<uint32_t>(a)),
+      _child_ranges(arena_allocator<range>(a)),
+      _children(arena_allocator<uint32_t>(a)),
+      _child_slots(arena_allocator<uint32_t>(a)),
+      _root(0),
+      _parse(new parse_state())
+{
+}
+
+uint32_t object_table::_find_or_add(string_ref path)
+{
+    auto it = _parse->index.find(path);
+    if(it != _parse->index.end())
+        return it->second;
+    uint32_t i = uint32_t(_paths.size());
+    path = _arena->copy(path.data, path.size);
+    _parse->index.emplace(path, i);
+    _paths.push_back(path);
+    _types.push_back(&data_type_t::_invalid_datatype);
+    _number_values.push_back(0);
+    _flags.push_back(0);
+    _parse->previous.push_back(nullptr);
+    _parse->last_block.push_back(no_block);
+    _parse->last_start_time.push_back(no_block);
+    return i;
+}
+
+int64_t object_table::_find(string_ref path) const
+{
+    auto it = std::lower_bound(_by_path.begin(), _by_path.end(), path,
+            [this](uint32_t i, const string_ref& p){
+                return _paths[i] < p;
+            });
+    if(it == _by_path.end() || _paths[*it] != path)
+        return -1;
+    return *it;
+}
+
+int64_t object_table::_child(uint32_t parent, string_ref name) const
+{
+    size_t mask = _child_slots.size() - 1;
+    size_t h = property_key_hash()(property_key(parent, name)) & mask;
+    for(; _child_slots[h] != no_row; h = (h + 1) & mask)
+    {
+        uint32_t i = _child_slots[h];
+        if(_parents[i] == parent && _names[i] == name)
+            return i;
+    }
+    return -1;
+}
+
+size_t object_table::property_key_hash::operator()(const property_key& k) const
+{
+    // FNV-1a over the name, mixed with the row
+    size_t h = 14695981039346656037ULL ^ k.first;
+    for(size_t i = 0; i < k.second.size; ++i)
+    {
+        h ^= (unsigned char) k.second.data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+void object_table::_add_property(uint32_t i, const property_entry& p)
+{
+    auto inserted = _parse->property_index.emplace(property_key(i, p.name),
+            uint32_t(_parse->properties.size()));
+    if(inserted.second)
+        _parse->properties.push_back(std::make_pair(i, p));
+    else
+        _parse->properties[inserted.first->second].second = p;
+
+    // Writers often repeat the start time with every segment, only a
+    // new value starts a new run of values
+    if(p.name != wf_start_time || p.type->name != "tdsTypeTimeStamp")
+        return;
+    uint32_t& last = _parse->last_start_time[i];
+    if(last != no_block)
+    {
+        const property_entry& previous = _parse->start_times[last].second.value;
+        if(previous.big_endian == p.big_endian
+                && memcmp(previous.value, p.value, p.type->length) == 0)
+            return;
+    }
+    last = uint32_t(_parse->start_times.size());
+    _parse->start_times.push_back(std::make_pair(i, start_time{_number_values[i], p}));
+}
+
+void object_table::_plan_values(uint32_t i, size_t number_values,
+        size_t block_size)
+{
+    if(number_values == 0)
+        return;
+    size_t value_size = _types[i]->ctype_length;
+    uint32_t& last = _parse->last_block[i];
+    auto& blocks = _parse->blocks;
+    if(last == no_block || (block_size != 0 && (blocks[last].second.number_values
+                    + number_values) * value_size > block_size))
+    {
+        size_t first = (last == no_block) ? 0
+            : blocks[last].second.first_value + blocks[last].second.number_values;
+        last = uint32_t(blocks.size());
+        blocks.push_back(std::make_pair(i, object::block{nullptr, first, 0, false}));
+    }
+    blocks[last].second.number_values += number_values;
+}
+
+void object_table::_build_tree()
+{
+    size_t listed = size();
+    _root = _find_or_add(root_path);
+    // Channels of a group mostly follow each other
+    string_ref last_parent = root_path;
+    uint32_t last_parent_row = _root;
+    // Missing parents are added at the end, and get their turn as well
+    for(uint32_t i = 0; i < size(); ++i)
+    {
+        string_ref path = _paths[i];
+        string_ref parent, name;
+        if(path == root_path)
+        {
+            _names.push_back(string_ref());
+            _parents.push_back(no_row);
+            continue;
+        }
+        if(!split_path(path, parent, name))
+        {
+            log::debug << "Object path " << path.str() << " isn't quoted"
+                << log::endl;
+            parent = root_path;
+            name = path;
+        }
+        else if(std::search_n(name.data, name.data + name.size, 2, '\'')
+                != name.data + name.size)
+        {
+            std::string unescaped;
+            for(size_t c = 0; c < name.size; ++c)
+            {
+                unescaped += name.data[c];
+                if(name.data[c] == '\'')
+                    ++c;
+            }
+            name = _arena->copy(unescaped.data(), unescaped.size());
+        }
+        _names.push_back(name);
+        if(parent != last_parent)
+        {
+            last_parent = parent;
+            last_parent_row = _find_or_add(parent);
+        }
+        _parents.push_back(last_parent_row);
+    }
+    for(size_t i = listed; i < size(); ++i)
+        _flags[i] |= IMPLICIT;
+
+    std::vector<std::pair<uint32_t, uint32_t>> children;
+    for(uint32_t i = 0; i < size(); ++i)
+    {
+        if(_parents[i] != no_row)
+            children.push_back(std::make_pair(_parents[i], i));
+    }
+    _children.reserve(children.size());
+    group(children, size(), _children, _child_ranges);
+
+    // At most half full, so probes stay short
+    size_t slots = 16;
+    while(slots < 2 * size())
+        slots *= 2;
+    _child_slots.assign(slots, no_row);
+    for(auto& c : children)
+    {
+        size_t h = property_key_hash()(property_key(c.first, _names[c.second]))
+            & (slots - 1);
+        while(_child_slots[h] != no_row)
+            h = (h + 1) & (slots - 1);
+        _child_slots[h] = c.second;
+    }
+}
+
+void object_table::_finish_metadata(
+        const std::function<bool (const object&)>& select)
+{
+    _build_tree();
+    size_t rows = size();
+
+    // Sort the properties of every object by name
+    auto& properties = _parse->properties;
+    std::sort(properties.begin(), properties.end(),
+            [](const std::pair<uint32_t, property_entry>& a,
+                const std::pair<uint32_t, property_entry>& b){
+                if(a.first != b.first)
+                    return a.first < b.first;
+                return a.second.name < b.second.name;
+            });
+    _parse->property_index.clear();
+    _start_times.reserve(_parse->start_times.size());
+    group(_parse->start_times, rows, _start_times, _start_time_ranges);
+    _properties.reserve(properties.size());
+    group(properties, rows, _properties, _property_ranges);
+
+    _handles = static_cast<object*>(_arena->allocate(rows * sizeof(object),
+                alignof(object)));
+    for(size_t i = 0; i < rows; ++i)
+        new (_handles + i) object(this, uint32_t(i));
+    _by_path.reserve(rows);
+    for(auto& entry : _parse->index)
+    {
+        if(!(_flags[entry.second] & IMPLICIT))
+            _by_path.push_back(entry.second);
+    }
+
+    // Skipped objects get no blocks
+    auto& blocks = _parse->blocks;
+    if(select)
+    {
+        for(size_t i = 0; i < rows; ++i)
+        {
+            if(!select(_handles[i]))
+                _flags[i] |= SKIPPED;
+        }
+        blocks.erase(std::remove_if(blocks.begin(), blocks.end(),
+                [this](const std::pair<uint32_t, object::block>& b){
+                    return (_flags[b.first] & SKIPPED) != 0;
+                }), blocks.end());
+    }
+    _blocks.reserve(blocks.size());
+    group(blocks, rows, _blocks, _block_ranges);
+    _parse->insert_block.assign(rows, 0);
+    _parse->insert_value.assign(rows, 0);
+}
+
+void* object_table::_insert_values(uint32_t i, size_t number_values)
+{
+    if(number_values == 0)
+        return nullptr;
+    const range& r = _block_ranges[i];
+    uint32_t& b = _parse->insert_block[i];
+    uint64_t& value = _parse->insert_value[i];
+    // Segments never straddle blocks
+    while(_blocks[r.begin + b].first_value
+            + _blocks[r.begin + b].number_values <= value)
+    {
+        ++b;
+    }
+    const object::block& block = _blocks[r.begin + b];
+    void* p = (unsigned char*)block.data
+        + (value - block.first_value) * _types[i]->ctype_length;
+    value += number_values;
+    return block.reused ? nullptr : p;
+}
+
+void object_table::_add_extent(uint32_t i, const object::extent& e)
+{
+    _parse->extents.push_back(std::make_pair(i, e));
+}
+
+size_t object_table::_extent_at(uint32_t i, uint64_t value) const
+{
+    const range& r = _extent_ranges[i];
+    if(r.count == 0)
+        return 0;
+    if(_regular_extents[i] != 0)
+        return std::min<uint64_t>(value / _regular_extents[i], r.count - 1);
+    const uint64_t* starts = _extent_starts.data() + r.begin;
+    return std::upper_bound(starts, starts + r.count, value) - starts - 1;
+}
+
+void object_table::_finish_raw_data()
+{
+    _extents.reserve(_parse->extents.size());
+    group(_parse->extents, size(), _extents, _extent_ranges);
+
+    _extent_starts.resize(_extents.size());
+    _regular_extents.assign(size(), 0);
+    for(size_t i = 0; i < size(); ++i)
+    {
+        const range& r = _extent_ranges[i];
+        uint64_t start = 0;
+        bool regular = r.count > 0;
+        for(uint32_t e = r.begin; e < r.begin + r.count; ++e)
+        {
+            _extent_starts[e] = start;
+            start += _extents[e].number_values;
+            if(e + 1 < r.begin + r.count
+                    && _extents[e].number_values != _extents[r.begin].number_values)
+                regular = false;
+        }
+        if(regular)
+            _regular_extents[i] = _extents[r.begin].number_values;
+    }
+    _parse.reset();
+}
+
+}
@@ -0,0 +1,127 @@
+#include <cstdint>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "page_allocator.hpp"
+#include "log.hpp"
+
+namespace TDMS
+{
+
+page_allocator::page_allocator(page_policy pages, bool bind_to_local_node)
+    : _pages(pages),
+      _bind(bind_to_local_node)
+{
+}
+
+#if defined(__linux__)
+
+namespace
+{
+
+const size_t huge_page_size = 2 << 20;
+
+size_t round_up(size_t n, size_t to)
+{
+    return (n + to - 1) / to * to;
+}
+
+// Binds the pages to the node of the calling thread. Uses the system
+// calls directly, so there's no dependency on libnuma.
+void bind_to_current_node(void* p, size_t length)
+{
+#if defined(SYS_getcpu) && defined(SYS_mbind)
+    unsigned cpu = 0, node = 0;
+    if(syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+        return;
+    const int mpol_bind = 2;
+    const size_t bits = 8 * sizeof(unsigned long);
+    unsigned long mask[16] = {0};
+    if(node >= 16 * bits)
+        return;
+    mask[node / bits] = 1UL << (node % bits);
+    if(syscall(SYS_mbind, p, length, mpol_bind, mask, 16 * bits + 1, 0) != 0)
+        log::debug << "Binding to NUMA node " << node << " failed" << log::endl;
+#endif
+}
+
+}
+
+void* page_allocator::allocate(const object&, size_t bytes)
+{
+    if(bytes == 0)
+        return nullptr;
+    size_t page = sysconf(_SC_PAGESIZE);
+    void* start = MAP_FAILED;
+    size_t length = 0;
+    void* p = nullptr;
+
+#if defined(MAP_HUGETLB)
+    if(_pages == page_policy::HUGETLB)
+    {
+        length = round_up(bytes, huge_page_size);
+        start = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(start == MAP_FAILED)
+            log::debug << "No huge pages reserved, using transparent ones" << log::endl;
+        p = start;
+    }
+#endif
+    if(start == MAP_FAILED && _pages != page_policy::NORMAL)
+    {
+        // Over-allocate so a huge page aligned range fits
+        length = round_up(bytes, huge_page_size) + huge_page_size;
+        start = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(start == MAP_FAILED)
+            return nullptr;
+        p = (void*) round_up(uintptr_t(start), huge_page_size);
+#if defined(MADV_HUGEPAGE)
+        madvise(p, round_up(bytes, huge_page_size), MADV_HUGEPAGE);
+#endif
+    }
+    if(start == MAP_FAILED)
+    {
+        length = round_up(bytes, page);
+        start = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(start == MAP_FAILED)
+            return nullptr;
+        p = start;
+    }
+    if(_bind)
+        bind_to_current_node(p, round_up(bytes, page));
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _mappings[p] = std::make_pair(start, length);
+    return p;
+}
+
+void page_allocator::deallocate(const object&, void* data, size_t)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _mappings.find(data);
+    if(it == _mappings.end())
+        return;
+    munmap(it->second.first, it->second.second);
+    _mappings.erase(it);
+}
+
+#else
+
+void* page_allocator::allocate(const object&, size_t)
+{
+    return nullptr;
+}
+
+void page_allocator::deallocate(const object&, void*, size_t)
+{
+}
+
+#endif
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <map>
+#include <mutex>
+
+#include "tdms.hpp"
+
+namespace TDMS
+{
+
+enum class page_policy
+{
+    // Plain pages from an anonymous mapping
+    NORMAL,
+    // Transparent huge pages through madvise
+    TRANSPARENT_HUGE,
+    // Explicit huge pages from MAP_HUGETLB, falling back to
+    // transparent huge pages when none are reserved
+    HUGETLB
+};
+
+// Allocates decoded data straight from the kernel, page aligned, with a
+// page size and NUMA placement policy. Pages are placed on first touch,
+// which is the decoding thread, or bound to the NUMA node the allocating
+// thread runs on. Pass it as file_options::allocator. Only does something
+// on Linux, elsewhere objects fall back to malloc.
+class page_allocator : public data_allocator
+{
+public:
+    explicit page_allocator(page_policy pages = page_policy::NORMAL,
+            bool bind_to_local_node = false);
+
+    void* allocate(const object& o, size_t bytes) override;
+    void deallocate(const object& o, void* data, size_t bytes) override;
+private:
+    page_policy _pages;
+    bool _bind;
+    std::mutex _mutex;
+    // Start and length of each mapping, as they're rounded up
+    std::map<void*, std::pair<void*, size_t>> _mappings;
+};
+
+}
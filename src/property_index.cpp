@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <unordered_set>
+
+#include "property_index.hpp"
+#include "data_extraction.hpp"
+
+namespace TDMS
+{
+
+namespace
+{
+
+bool starts_with(const string_ref& s, const std::string& prefix)
+{
+    return s.size >= prefix.size()
+        && memcmp(s.data, prefix.data(), prefix.size()) == 0;
+}
+
+}
+
+property_index::property_index(const file& f)
+{
+    add(f);
+}
+
+void property_index::add(const file& f)
+{
+    // Where the new postings of every name start, to sort only those
+    // and merge them with the ones before
+    std::unordered_map<postings*, std::pair<size_t, size_t>> added;
+    for(const object* o : f)
+    {
+        const object_table& t = *o->_table;
+        uint32_t id = uint32_t(_objects.size());
+        _objects.push_back(o);
+        for(const object_table::property_entry& p : t._properties_of(o->_index))
+        {
+            postings& ps = _names[p.name.str()];
+            added.emplace(&ps, std::make_pair(ps.strings.size(), ps.numbers.size()));
+            if(p.type->name == "tdsTypeString")
+            {
+                ps.strings.push_back(std::make_pair(
+                            read_string_ref(p.value,
+                                p.big_endian ? BIG : LITTLE), id));
+            }
+            else if(p.type->name == "tdsTypeTimeStamp")
+            {
+                timestamp ts;
+                p.type->read(p.value, &ts, p.big_endian);
+                ps.numbers.push_back(std::make_pair(ts.unix_time(), id));
+            }
+            else if(p.type->numeric != numeric_type::NONE)
+            {
+                double v;
+                kernels::converter(p.type->numeric, numeric_type::FLOAT64,
+                        p.big_endian)(p.value, p.type->length, &v, 1);
+                // NaNs match no range, and would break the ordering
+                if(!std::isnan(v))
+                    ps.numbers.push_back(std::make_pair(v, id));
+            }
+        }
+    }
+    for(auto& a : added)
+    {
+        postings& ps = *a.first;
+        std::sort(ps.strings.begin() + a.second.first, ps.strings.end());
+        std::inplace_merge(ps.strings.begin(),
+                ps.strings.begin() + a.second.first, ps.strings.end());
+        std::sort(ps.numbers.begin() + a.second.second, ps.numbers.end());
+        std::inplace_merge(ps.numbers.begin(),
+                ps.numbers.begin() + a.second.second, ps.numbers.end());
+    }
+}
+
+const property_index::postings* property_index::_find(
+        const std::string& name) const
+{
+    auto it = _names.find(name);
+    return it == _names.end() ? nullptr : &it->second;
+}
+
+std::vector<const object*> property_index::_objects_of(
+        std::vector<uint32_t>& ids) const
+{
+    std::sort(ids.begin(), ids.end());
+    std::vector<const object*> objects;
+    objects.reserve(ids.size());
+    for(uint32_t id : ids)
+        objects.push_back(_objects[id]);
+    return objects;
+}
+
+std::vector<const object*> property_index::equal(const std::string& name,
+        const std::string& value) const
+{
+    std::vector<uint32_t> ids;
+    const postings* ps = _find(name);
+    if(ps == nullptr)
+        return std::vector<const object*>();
+    string_ref v(value);
+    auto it = std::lower_bound(ps->strings.begin(), ps->strings.end(),
+            std::make_pair(v, uint32_t(0)));
+    for(; it != ps->strings.end() && it->first == v; ++it)
+        ids.push_back(it->second);
+    return _objects_of(ids);
+}
+
+std::vector<const object*> property_index::equal(const std::string& name,
+        double value) const
+{
+    return range(name, value, value);
+}
+
+std::vector<const object*> property_index::prefix(const std::string& name,
+        const std::string& prefix) const
+{
+    std::vector<uint32_t> ids;
+    const postings* ps = _find(name);
+    if(ps == nullptr)
+        return std::vector<const object*>();
+    auto it = std::lower_bound(ps->strings.begin(), ps->strings.end(),
+            std::make_pair(string_ref(prefix), uint32_t(0)));
+    for(; it != ps->strings.end() && starts_with(it->first, prefix); ++it)
+        ids.push_back(it->second);
+    return _objects_of(ids);
+}
+
+std::vector<const object*> property_index::range(const std::string& name,
+        double low, double high) const
+{
+    std::vector<uint32_t> ids;
+    const postings* ps = _find(name);
+    if(ps == nullptr)
+        return std::vector<const object*>();
+    auto it = std::lower_bound(ps->numbers.begin(), ps->numbers.end(), low,
+            [](const std::pair<double, uint32_t>& p, double v){
+                return p.first < v;
+            });
+    for(; it != ps->numbers.end() && it->first <= high; ++it)
+        ids.push_back(it->second);
+    return _objects_of(ids);
+}
+
+std::vector<const object*> property_index::both(
+        const std::vector<const object*>& a, const std::vector<const object*>& b)
+{
+    std::unordered_set<const object*> in_b(b.begin(), b.end());
+    std::vector<const object*> result;
+    for(const object* o : a)
+    {
+        if(in_b.count(o))
+            result.push_back(o);
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "tdms.hpp"
+
+namespace TDMS
+{
+
+// Inverted index over the property values of the objects of one or
+// more files, to find objects by their properties without going
+// through all of them. Built from the properties read when opening;
+// string values point into the file contents, so the files must
+// outlive the index.
+//
+// Numeric and boolean values are indexed as doubles, timestamps as
+// seconds since the Unix epoch. Results are in the order the objects
+// were added, and can be combined with both().
+class property_index
+{
+public:
+    property_index() = default;
+    explicit property_index(const file& f);
+
+    // Adds the objects of f
+    void add(const file& f);
+
+    // Objects with a string property name of exactly value
+    std::vector<const object*> equal(const std::string& name,
+            const std::string& value) const;
+    // Objects with a numeric property name equal to value
+    std::vector<const object*> equal(const std::string& name,
+            double value) const;
+    // Objects with a string property name starting with prefix
+    std::vector<const object*> prefix(const std::string& name,
+            const std::string& prefix) const;
+    // Objects with a numeric property name in [low, high]
+    std::vector<const object*> range(const std::string& name, double low,
+            double high) const;
+
+    // The objects of a that are also in b, in the order of a
+    static std::vector<const object*> both(const std::vector<const object*>& a,
+            const std::vector<const object*>& b);
+
+    size_t size() const
+    {
+        return _objects.size();
+    }
+private:
+    // Sorted by value, then by object
+    struct postings
+    {
+        std::vector<std::pair<string_ref, uint32_t>> strings;
+        std::vector<std::pair<double, uint32_t>> numbers;
+    };
+
+    const postings* _find(const std::string& name) const;
+    std::vector<const object*> _objects_of(std::vector<uint32_t>& ids) const;
+
+    std::vector<const object*> _objects;
+    std::unordered_map<std::string, postings> _names;
+};
+
+}
@@ -0,0 +1,440 @@
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+
+#include "scaling.hpp"
+#include "decode_kernels.hpp"
+#include "log.hpp"
+
+namespace TDMS
+{
+
+// Input source of scales that work on the raw data
+const uint32_t raw_data_input_source = 0xFFFFFFFF;
+
+// NIST ITS-90 thermocouple polynomials
+const std::vector<scaling::thermocouple_type> thermocouple_types = {
+    // Type J
+    {10072,
+        {
+            {-210.0, 760.0, {0.0, 5.0381187815E-02, 3.0475836930E-05,
+                -8.5681065720E-08, 1.3228195295E-10, -1.7052958337E-13,
+                2.0948090697E-16, -1.2538395336E-19, 1.5631725697E-23}},
+            {760.0, 1200.0, {2.96456256810E+02, -1.49761277860E+00,
+                3.17871039240E-03, -3.18476867010E-06, 1.57208190040E-09,
+                -3.06913690560E-13}}
+        },
+        {
+            {-8.095, 0.0, {0.0, 1.9528268E+01, -1.2286185E+00, -1.0752178E+00,
+                -5.9086933E-01, -1.7256713E-01, -2.8131513E-02,
+                -2.3963370E-03, -8.3823321E-05}},
+            {0.0, 42.919, {0.0, 1.978425E+01, -2.001204E-01, 1.036969E-02,
+                -2.549687E-04, 3.585153E-06, -5.344285E-08, 5.099890E-10}},
+            {42.919, 69.553, {-3.11358187E+03, 3.00543684E+02,
+                -9.94773230E+00, 1.70276630E-01, -1.43033468E-03,
+                4.73886084E-06}}
+        },
+        0.0, 0.0, 0.0},
+    // Type K
+    {10073,
+        {
+            {-270.0, 0.0, {0.0, 0.394501280250E-01, 0.236223735980E-04,
+                -0.328589067840E-06, -0.499048287770E-08, -0.675090591730E-10,
+                -0.574103274280E-12, -0.310888728940E-14, -0.104516093650E-16,
+                -0.198892668780E-19, -0.163226974860E-22}},
+            {0.0, 1372.0, {-0.176004136860E-01, 0.389212049750E-01,
+                0.185587700320E-04, -0.994575928740E-07, 0.318409457190E-09,
+                -0.560728448890E-12, 0.560750590590E-15, -0.320207200030E-18,
+                0.971511471520E-22, -0.121047212750E-25}}
+        },
+        {
+            {-5.891, 0.0, {0.0, 2.5173462E+01, -1.1662878E+00, -1.0833638E+00,
+                -8.9773540E-01, -3.7342377E-01, -8.6632643E-02,
+                -1.0450598E-02, -5.1920577E-04}},
+            {0.0, 20.644, {0.0, 2.508355E+01, 7.860106E-02, -2.503131E-01,
+                8.315270E-02, -1.228034E-02, 9.804036E-04, -4.413030E-05,
+                1.057734E-06, -1.052755E-08}},
+            {20.644, 54.886, {-1.318058E+02, 4.830222E+01, -1.646031E+00,
+                5.464731E-02, -9.650715E-04, 8.802193E-06, -3.110810E-08}}
+        },
+        0.1185976, -0.1183432E-03, 0.1269686E+03},
+    // Type T
+    {10086,
+        {
+            {-270.0, 0.0, {0.0, 0.387481063640E-01, 0.441944343470E-04,
+                0.118443231050E-06, 0.200329735540E-07, 0.901380195590E-09,
+                0.226511565930E-10, 0.360711542050E-12, 0.384939398830E-14,
+                0.282135219250E-16, 0.142515947790E-18, 0.487686622860E-21,
+                0.107955392700E-23, 0.139450270620E-26, 0.797951539270E-30}},
+            {0.0, 400.0, {0.0, 0.387481063640E-01, 0.332922278800E-04,
+                0.206182434040E-06, -0.218822568460E-08, 0.109968809280E-10,
+                -0.308157587720E-13, 0.454791352900E-16, -0.275129016730E-19}}
+        },
+        {
+            {-5.603, 0.0, {0.0, 2.5949192E+01, -2.1316967E-01, 7.9018692E-01,
+                4.2527777E-01, 1.3304473E-01, 2.0241446E-02, 1.2668171E-03}},
+            {0.0, 20.872, {0.0, 2.592800E+01, -7.602961E-01, 4.637791E-02,
+                -2.165394E-03, 6.048144E-05, -7.293422E-07}}
+        },
+        0.0, 0.0, 0.0}
+};
+
+// RTD resistance configurations
+const int32_t rtd_2_wire = 2;
+const int32_t rtd_3_wire = 3;
+
+inline double evaluate_polynomial(const std::vector<double>& c, double x)
+{
+    double r = 0.0;
+    for(size_t i = c.size(); i > 0; --i)
+    {
+        r = r*x + c[i - 1];
+    }
+    return r;
+}
+
+inline const scaling::thermocouple_range& find_range(
+        const std::vector<scaling::thermocouple_range>& ranges, double x)
+{
+    // Out of range values are extrapolated with the nearest polynomial
+    size_t i = 0;
+    while(i + 1 < ranges.size() && x >= ranges[i].upper)
+        ++i;
+    return ranges[i];
+}
+
+double thermocouple_voltage(const scaling::thermocouple_type& t, double temperature)
+{
+    double mv = evaluate_polynomial(find_range(t.forward, temperature).coefficients,
+            temperature);
+    if(t.a0 != 0.0 && temperature >= 0.0)
+    {
+        double d = temperature - t.a2;
+        mv += t.a0 * std::exp(t.a1 * d * d);
+    }
+    return mv;
+}
+
+class property_reader
+{
+public:
+    property_reader(const object* o)
+        : _object(o)
+    {
+    }
+
+    bool has(const std::string& name) const
+    {
+        return _object->get_property(name) != nullptr;
+    }
+
+    std::string string(const std::string& name) const
+    {
+        auto p = _object->get_property(name);
+        if(p == nullptr)
+            throw std::runtime_error("Missing scaling property " + name);
+        if(p->data_type.name != "tdsTypeString")
+            throw std::runtime_error("Scaling property " + name + " isn't a string");
+        return *(const std::string*) p->value;
+    }
+
+    double number(const std::string& name) const
+    {
+        auto p = _object->get_property(name);
+        if(p == nullptr)
+            throw std::runtime_error("Missing scaling property " + name);
+        numeric_type t = p->data_type.numeric;
+        if(t == numeric_type::EXTENDED)
+            t = numeric_type::FLOAT64;
+        if(t == numeric_type::NONE)
+            throw std::runtime_error("Scaling property " + name + " isn't numeric");
+        double d;
+        kernels::converter(t, numeric_type::FLOAT64)(
+                (const unsigned char*) p->value, numeric_type_size(t),
+                &d, 1);
+        return d;
+    }
+
+    double number(const std::string& name, double default_value) const
+    {
+        return has(name) ? number(name) : default_value;
+    }
+
+    std::vector<double> array(const std::string& prefix) const
+    {
+        size_t size = size_t(number(prefix + "_Size"));
+        std::vector<double> values(size);
+        for(size_t i = 0; i < size; ++i)
+        {
+            values[i] = number(prefix + "[" + std::to_string(i) + "]");
+        }
+        return values;
+    }
+private:
+    const object* _object;
+};
+
+scaling::scaling(const object* o)
+{
+    property_reader properties(o);
+    if(!properties.has("NI_Scaling_Status")
+            || properties.string("NI_Scaling_Status") != "unscaled")
+    {
+        return;
+    }
+    uint32_t number_of_scales = uint32_t(properties.number("NI_Number_Of_Scales"));
+    if(number_of_scales == 0)
+        return;
+
+    // Walk from the last scale back to the raw data
+    std::vector<step> chain;
+    uint32_t index = number_of_scales - 1;
+    while(index != raw_data_input_source)
+    {
+        if(index >= number_of_scales || chain.size() > number_of_scales)
+        {
+            throw std::runtime_error("Invalid scale input source for "
+                    + o->get_path());
+        }
+        std::string prefix = "NI_Scale[" + std::to_string(index) + "]";
+        std::string type = properties.string(prefix + "_Scale_Type");
+        log::debug << "Scale " << index << " is " << type << log::endl;
+
+        step s;
+        s.thermocouple = nullptr;
+        if(type == "Linear")
+        {
+            prefix += "_Linear";
+            s.type = POLYNOMIAL;
+            s.coefficients = {properties.number(prefix + "_Y_Intercept"),
+                properties.number(prefix + "_Slope")};
+        }
+        else if(type == "Polynomial")
+        {
+            prefix += "_Polynomial";
+            s.type = POLYNOMIAL;
+            s.coefficients = properties.array(prefix + "_Coefficients");
+        }
+        else if(type == "Table")
+        {
+            prefix += "_Table";
+            s.type = TABLE;
+            s.pre_scaled = properties.array(prefix + "_Pre_Scaled_Values");
+            s.scaled = properties.array(prefix + "_Scaled_Values");
+            if(s.pre_scaled.size() != s.scaled.size() || s.scaled.empty())
+            {
+                throw std::runtime_error("Invalid table scale for "
+                        + o->get_path());
+            }
+            // Interpolation needs increasing pre-scaled values
+            if(s.pre_scaled.front() > s.pre_scaled.back())
+            {
+                std::reverse(s.pre_scaled.begin(), s.pre_scaled.end());
+                std::reverse(s.scaled.begin(), s.scaled.end());
+            }
+        }
+        else if(type == "RTD")
+        {
+            prefix += "_RTD";
+            s.type = RTD;
+            s.current_excitation = properties.number(prefix + "_Current_Excitation");
+            s.r0 = properties.number(prefix + "_R0_Nominal_Resistance");
+            s.a = properties.number(prefix + "_A");
+            s.b = properties.number(prefix + "_B");
+            s.c = properties.number(prefix + "_C");
+            double lead = properties.number(prefix + "_Lead_Wire_Resistance", 0.0);
+            int32_t configuration = int32_t(properties.number(
+                        prefix + "_Resistance_Configuration"));
+            if(configuration == rtd_2_wire)
+                s.lead_wire_resistance = 2*lead;
+            else if(configuration == rtd_3_wire)
+                s.lead_wire_resistance = lead;
+            else
+                s.lead_wire_resistance = 0.0;
+        }
+        else if(type == "Thermocouple")
+        {
+            prefix += "_Thermocouple";
+            s.type = THERMOCOUPLE;
+            uint32_t code = uint32_t(properties.number(prefix + "_Type"));
+            for(const thermocouple_type& t : thermocouple_types)
+            {
+                if(t.code == code)
+                    s.thermocouple = &t;
+            }
+            if(s.thermocouple == nullptr)
+            {
+                throw std::runtime_error("Unsupported thermocouple type "
+                        + std::to_string(code) + " for " + o->get_path()
+                        + ", only types J, K and T are supported");
+            }
+            // Only a constant cold junction temperature is supported
+            s.cjc_voltage = thermocouple_voltage(*s.thermocouple,
+                    properties.number(prefix + "_CJC_Value", 25.0));
+        }
+        else
+        {
+            throw std::runtime_error("Unsupported scale type " + type);
+        }
+        index = uint32_t(properties.number(prefix + "_Input_Source",
+                    raw_data_input_source));
+        chain.push_back(s);
+    }
+
+    // The chain was built last scale first
+    for(auto it = chain.rbegin(); it != chain.rend(); ++it)
+    {
+        if(_steps.empty() || !_fold(_steps.back(), *it))
+            _steps.push_back(*it);
+    }
+}
+
+bool scaling::_fold(step& into, const step& s)
+{
+    // Composes s(into(x)) into a single polynomial, if both are
+    // polynomials and the result stays of reasonable degree.
+    if(into.type != POLYNOMIAL || s.type != POLYNOMIAL
+            || into.coefficients.empty() || s.coefficients.empty())
+        return false;
+    size_t degree = (into.coefficients.size() - 1) * (s.coefficients.size() - 1);
+    if(degree > 8)
+        return false;
+
+    const std::vector<double>& f = into.coefficients;
+    std::vector<double> result(1, s.coefficients.back());
+    for(size_t k = s.coefficients.size() - 1; k > 0; --k)
+    {
+        std::vector<double> product(result.size() + f.size() - 1, 0.0);
+        for(size_t i = 0; i < result.size(); ++i)
+            for(size_t j = 0; j < f.size(); ++j)
+                product[i + j] += result[i] * f[j];
+        product[0] += s.coefficients[k - 1];
+        result.swap(product);
+    }
+    into.coefficients.swap(result);
+    return true;
+}
+
+void scaling::_apply(const step& s, double* values, size_t n) const
+{
+    switch(s.type)
+    {
+    case POLYNOMIAL:
+        {
+            const double* c = s.coefficients.data();
+            size_t m = s.coefficients.size();
+            if(m == 0)
+            {
+                std::fill(values, values + n, 0.0);
+            }
+            else if(m == 2)
+            {
+                const double offset = c[0], slope = c[1];
+                for(size_t i = 0; i < n; ++i)
+                    values[i] = values[i]*slope + offset;
+            }
+            else
+            {
+                for(size_t i = 0; i < n; ++i)
+                {
+                    double x = values[i];
+                    double r = c[m - 1];
+                    for(size_t k = m - 1; k > 0; --k)
+                        r = r*x + c[k - 1];
+                    values[i] = r;
+                }
+            }
+        }
+        break;
+    case TABLE:
+        {
+            const std::vector<double>& xs = s.pre_scaled;
+            const std::vector<double>& ys = s.scaled;
+            for(size_t i = 0; i < n; ++i)
+            {
+                double x = values[i];
+                if(x <= xs.front())
+                {
+                    values[i] = ys.front();
+                    continue;
+                }
+                if(x >= xs.back())
+                {
+                    values[i] = ys.back();
+                    continue;
+                }
+                size_t j = std::upper_bound(xs.begin(), xs.end(), x) - xs.begin();
+                double t = (x - xs[j - 1]) / (xs[j] - xs[j - 1]);
+                values[i] = ys[j - 1] + t*(ys[j] - ys[j - 1]);
+            }
+        }
+        break;
+    case RTD:
+        {
+            // Callendar-Van Dusen: R/R0 = 1 + A T + B T^2 + C (T - 100) T^3,
+            // where the C term only applies below 0 °C. Solve the quadratic
+            // part directly, then refine negative temperatures with Newton
+            // steps on the full equation.
+            const double a = s.a, b = s.b, c = s.c, r0 = s.r0;
+            const double inv_current = 1.0 / s.current_excitation;
+            for(size_t i = 0; i < n; ++i)
+            {
+                double r = values[i]*inv_current - s.lead_wire_resistance;
+                double k = 1.0 - r/r0;
+                double t = (-a + std::sqrt(a*a - 4*b*k)) / (2*b);
+                if(t < 0.0)
+                {
+                    for(int it = 0; it < 4; ++it)
+                    {
+                        double f = k + a*t + b*t*t + c*(t - 100.0)*t*t*t;
+                        double df = a + 2*b*t + c*(4*t - 300.0)*t*t;
+                        t -= f/df;
+                    }
+                }
+                values[i] = t;
+            }
+        }
+        break;
+    case THERMOCOUPLE:
+        {
+            const thermocouple_type& tc = *s.thermocouple;
+            for(size_t i = 0; i < n; ++i)
+            {
+                double mv = values[i]*1000.0 + s.cjc_voltage;
+                values[i] = evaluate_polynomial(
+                        find_range(tc.inverse, mv).coefficients, mv);
+            }
+        }
+        break;
+    }
+}
+
+void scaling::apply(double* values, size_t n) const
+{
+    for(const step& s : _steps)
+    {
+        _apply(s, values, n);
+    }
+}
+
+size_t scaling::read(const object* o, double* target,
+        size_t start, size_t count) const
+{
+    // Small enough blocks to keep every scale step working in L1
+    const size_t block = 2048;
+    size_t done = 0;
+    while(done < count)
+    {
+        size_t n = read_as(o, target + done, start + done,
+                std::min(block, count - done));
+        apply(target + done, n);
+        done += n;
+        if(n < block)
+            break;
+    }
+    return done;
+}
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "tdms.hpp"
+
+namespace TDMS
+{
+
+// Scale chain of a channel, as described by its NI_Scaling_Status,
+// NI_Number_Of_Scales and NI_Scale[n]_* properties.
+//
+// The chain is compiled once: the scales are resolved from the last one
+// back to the raw data through their input sources, and consecutive
+// linear and polynomial scales are folded into a single polynomial.
+class scaling
+{
+public:
+    // Throws std::runtime_error for unsupported scale types, and for
+    // thermocouples other than types J, K and T.
+    // Objects that aren't "unscaled" get the identity scaling.
+    explicit scaling(const object* o);
+
+    bool is_identity() const
+    {
+        return _steps.empty();
+    }
+
+    // Scales n values in place
+    void apply(double* values, size_t n) const;
+
+    // Reads count values of o in engineering units. The raw values are
+    // converted and scaled block by block, while they are still in cache.
+    // Returns the number of values read, like read_as.
+    size_t read(const object* o, double* target,
+            size_t start, size_t count) const;
+
+    struct thermocouple_range
+    {
+        double lower;
+        double upper;
+        std::vector<double> coefficients;
+    };
+    struct thermocouple_type
+    {
+        uint32_t code;
+        // Temperature [°C] to voltage [mV]
+        std::vector<thermocouple_range> forward;
+        // Voltage [mV] to temperature [°C]
+        std::vector<thermocouple_range> inverse;
+        // Extra exponential term of the type K forward polynomial
+        double a0, a1, a2;
+    };
+private:
+    enum step_type
+    {
+        POLYNOMIAL,
+        RTD,
+        THERMOCOUPLE,
+        TABLE
+    };
+    struct step
+    {
+        step_type type;
+        // Polynomial coefficients, lowest order first
+        std::vector<double> coefficients;
+        // Table scale
+        std::vector<double> pre_scaled;
+        std::vector<double> scaled;
+        // RTD scale
+        double current_excitation;
+        double lead_wire_resistance;
+        double r0, a, b, c;
+        // Thermocouple scale
+        const thermocouple_type* thermocouple;
+        double cjc_voltage;
+    };
+
+    void _apply(const step& s, double* values, size_t n) const;
+    static bool _fold(step& into, const step& s);
+
+    std::vector<step> _steps;
+};
+
+}
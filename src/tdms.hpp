@@ -1,18 +1,174 @@
 #pragma once
 #include <string>
+#include <algorithm>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <cstdint>
 #include <functional>
 #include <cstring>
+#include <cmath>
 #include <memory>
 #include "log.hpp"
+#include "decode_kernels.hpp"
+#include "arena.hpp"
+#include "channel_cache.hpp"
 
 namespace TDMS
 {
 
 class segment;
 class segment_object;
+class object;
+class mapped_allocator;
+class file_state;
+class zone_map;
+class property_index;
+struct envelope_bucket;
+template<typename T> class chunk_reader;
+
+// Reads count values of o, starting at value start, converted to the
+// numeric type t into target. Reads straight from the raw segment data,
+// the decoded data of o isn't used. The segments holding start are
+// found through an index, so only the requested values are decoded.
+// Returns the number of values read, which is less than count when
+// the object has fewer values. Floating point values read as an
+// integer type saturate to its range, and NaN reads as 0.
+size_t read_into(const object* o, numeric_type t, void* target,
+        size_t start, size_t count);
+
+template<typename T>
+size_t read_as(const object* o, T* target, size_t start, size_t count)
+{
+    return read_into(o, numeric_type_of<T>::value, target, start, count);
+}
+
+template<typename T>
+size_t read(const object* o, size_t start, size_t count, T* dst)
+{
+    return read_as(o, dst, start, count);
+}
+
+// Provides the memory objects decode their values into, so they can
+// land straight in memory the caller owns.
+class data_allocator
+{
+public:
+    virtual ~data_allocator() {}
+    // Called for every block of an object with data, after all metadata
+    // is parsed, so bytes() and the number of values of o are final.
+    // Returns nullptr for the first block to let the object allocate
+    // its memory itself.
+    virtual void* allocate(const object& o, size_t bytes) = 0;
+    // Called when a block is released or the file is destroyed,
+    // for memory from allocate()
+    virtual void deallocate(const object& /*o*/, void* /*data*/,
+            size_t /*bytes*/)
+    {
+    }
+    // True when memory from allocate() already holds the decoded
+    // values, so decoding them can be skipped
+    virtual bool holds_values(const object& /*o*/, const void* /*data*/)
+    {
+        return false;
+    }
+};
+
+// A tdsTypeTimeStamp value: seconds since 1904-01-01 00:00 UTC, and
+// positive fractions of a second in units of 2^-64 s
+struct timestamp
+{
+    uint64_t fractions;
+    int64_t seconds;
+
+    // Seconds since the Unix epoch, to about a microsecond
+    double unix_time() const
+    {
+        return double(seconds - 2082844800) + std::ldexp(double(fractions), -64);
+    }
+};
+
+// Bytes used by a file or an object. objects, properties and segments
+// are approximate: they are computed from the sizes of the elements,
+// without allocator overhead or unused capacity of every list. decoded
+// and mapped are exact.
+struct memory_usage
+{
+    memory_usage()
+        : objects(0),
+          properties(0),
+          segments(0),
+          decoded(0),
+          arena_reserved(0),
+          mapped(0)
+    {
+    }
+    // Object tables, paths, extent and block lists. The hash table of
+    // the tree is only counted for a file.
+    size_t objects;
+    // Property names, values and the maps holding them
+    size_t properties;
+    // Segments, segment objects and their lists
+    size_t segments;
+    // Decoded values held in blocks, also blocks in mapped files, and
+    // in the channel cache
+    size_t decoded;
+    // Taken by the metadata arena of the file, which holds the objects,
+    // properties and segments plus the slack of its last block
+    size_t arena_reserved;
+    // Size of the mapped file contents, not part of total()
+    size_t mapped;
+
+    size_t total() const
+    {
+        return objects + properties + segments + decoded;
+    }
+};
+
+struct file_options
+{
+    file_options()
+        : allocator(nullptr),
+          metadata_resource(nullptr),
+          block_size(0),
+          cache(nullptr),
+          keep_decoded(false)
+    {
+    }
+    // Allocates the decoded data of the objects, malloc when nullptr.
+    // Must outlive the file.
+    data_allocator* allocator;
+    // Where the metadata arena of the file takes its blocks from,
+    // operator new when nullptr. Must outlive the file.
+    memory_resource* metadata_resource;
+    // Store decoded values in blocks of about this many bytes instead of
+    // one allocation per object. Blocks hold whole segments, so a segment
+    // bigger than this gets a block of its own. 0 for one block.
+    size_t block_size;
+    // Decode numeric objects on demand into this cache, for example
+    // channel_cache::global(), instead of decoding everything while
+    // opening. Must outlive the file.
+    channel_cache* cache;
+    // Decode into memory mapped files in this directory instead of
+    // memory, so the kernel can page decoded data out. Can't be combined
+    // with allocator. POSIX only.
+    std::string decode_directory;
+    // Keep the files in decode_directory when the file is closed, and
+    // use them instead of decoding when it is opened again.
+    bool keep_decoded;
+    // Decode only the objects this returns true for, all when empty.
+    // It sees the path and properties of every object once the metadata
+    // is read. Objects that aren't selected keep their metadata, but
+    // their raw data is skipped and their values can't be read.
+    std::function<bool (const object& o)> select;
+};
+
+// Selects the objects with one of these paths
+std::function<bool (const object& o)> select_paths(
+        const std::vector<std::string>& paths);
+// Selects the objects whose path matches a glob, where * matches any
+// run of characters and ? any one, for example "/'Vibration'/*"
+std::function<bool (const object& o)> select_glob(const std::string& pattern);
 
 class data_type_t
 {
@@ -24,13 +180,15 @@ public:
           read_to(dt.read_to),
           read_array_to(dt.read_array_to),
           length(dt.length),
-          ctype_length(dt.ctype_length)
+          ctype_length(dt.ctype_length),
+          numeric(dt.numeric)
     {
     }
     data_type_t()
         : name("INVALID TYPE"),
           length(0),
-          ctype_length(0)
+          ctype_length(0),
+          numeric(numeric_type::NONE)
     {
         _init_default_array_reader();
     }
@@ -40,7 +198,8 @@ public:
         : name(_name),
           read_to(reader),
           length(_len),
-          ctype_length(_len)
+          ctype_length(_len),
+          numeric(numeric_type::NONE)
     {
         _init_default_array_reader();
     }
@@ -52,7 +211,8 @@ public:
           read_to(reader),
           read_array_to(array_reader),
           length(_len),
-          ctype_length(_len)
+          ctype_length(_len),
+          numeric(numeric_type::NONE)
     {
     }
 
@@ -63,10 +223,27 @@ public:
         : name(_name),
           read_to(reader),
           length(_len),
-          ctype_length(_ctype_len)
+          ctype_length(_ctype_len),
+          numeric(numeric_type::NONE)
     {
         _init_default_array_reader();
     }
+    data_type_t(const std::string& _name, 
+            const size_t _len,
+            const size_t _ctype_len,
+            std::function<void (const unsigned char*, void*)> reader,
+            std::function<void (const unsigned char*, void*, size_t)> array_reader)
+        : name(_name),
+          read_to(reader),
+          read_array_to(array_reader),
+          length(_len),
+          ctype_length(_ctype_len),
+          numeric(numeric_type::NONE)
+    {
+    }
+    // Fixed width numeric type, read and decoded through the kernels.
+    // Extended floats are decoded into doubles.
+    data_type_t(const std::string& _name, numeric_type t);
 
     bool is_valid() const
     {
@@ -83,28 +260,174 @@ public:
     }
 
     std::string name;
-    void* read(const unsigned char* data)
+    void* read(const unsigned char* data, bool big_endian = false) const
     {
         void* d = malloc(ctype_length);
-        read_to(data, d);
+        read(data, d, big_endian);
         return d;
     }
+    // Reads one value into target, which holds ctype_length bytes
+    void read(const unsigned char* data, void* target, bool big_endian) const
+    {
+        if(big_endian && numeric != numeric_type::NONE)
+        {
+            numeric_type decoded = (numeric == numeric_type::EXTENDED)
+                ? numeric_type::FLOAT64 : numeric;
+            kernels::converter(numeric, decoded, true)(data, length, target, 1);
+        }
+        else if(big_endian && length > 0 && length <= 16)
+        {
+            // Timestamps are the only other fixed width type; their big
+            // endian form is the little endian one reversed
+            unsigned char swapped[16];
+            std::reverse_copy(data, data + length, swapped);
+            read_to(swapped, target);
+        }
+        else
+        {
+            read_to(data, target);
+        }
+    }
     std::function<void (const unsigned char*, void*)> read_to;
     std::function<void (const unsigned char*, void*, size_t)> read_array_to;
     size_t length;
     size_t ctype_length;
+    // Type of the samples on disk, NONE for non-numeric types
+    numeric_type numeric;
 
     static const std::map<uint32_t, const data_type_t> _tds_datatypes;
+    static const data_type_t _invalid_datatype;
 private:
     void _init_default_array_reader();
 };
 
+// Contiguous run of elements, owned elsewhere
+template<typename T>
+class array_view
+{
+public:
+    array_view(const T* begin, size_t size)
+        : _begin(begin),
+          _size(size)
+    {
+    }
+    const T* begin() const
+    {
+        return _begin;
+    }
+    const T* end() const
+    {
+        return _begin + _size;
+    }
+    size_t size() const
+    {
+        return _size;
+    }
+    bool empty() const
+    {
+        return _size == 0;
+    }
+    const T& operator[](size_t i) const
+    {
+        return _begin[i];
+    }
+    const T& front() const
+    {
+        return _begin[0];
+    }
+private:
+    const T* _begin;
+    size_t _size;
+};
+
+class object_table;
+
+// Goes through a list of rows of the object table, yielding their handles
+template<typename O>
+class object_iterator
+{
+    friend class file;
+    friend class object;
+public:
+    O* operator*()
+    {
+        return _handles + *_it;
+    }
+    const object_iterator& operator++()
+    {
+        ++_it;
+
+        return *this;
+    }
+    bool operator !=(const object_iterator& other)
+    {
+        return other._it != _it;
+    }
+private:
+    object_iterator(O* handles, const uint32_t* it)
+        : _handles(handles),
+          _it(it)
+    {}
+    O* _handles;
+    const uint32_t* _it;
+};
+
+template<typename O>
+class object_range
+{
+public:
+    object_range(object_iterator<O> b, object_iterator<O> e)
+        : _begin(b),
+          _end(e)
+    {
+    }
+    object_iterator<O> begin() const
+    {
+        return _begin;
+    }
+    object_iterator<O> end() const
+    {
+        return _end;
+    }
+private:
+    object_iterator<O> _begin;
+    object_iterator<O> _end;
+};
+
+// Index of an object in the object table of its file. Stays valid as
+// long as the file does, also when the file is moved.
+struct object_handle
+{
+    static const uint32_t none = 0xFFFFFFFF;
+    uint32_t index;
+
+    // False for the handle file::find returns when there's no object
+    explicit operator bool() const
+    {
+        return index != none;
+    }
+};
+
+// Handle to a row of the object table of its file
 class object
 {
     friend class file;
+    friend class file_state;
+    friend class object_table;
     friend class segment;
     friend class segment_object;
+    friend class channel_cache;
+    friend class waveform;
+    friend class envelope_builder;
+    friend class zone_map;
+    friend class property_index;
+    template<typename T> friend class chunk_reader;
+    friend std::vector<envelope_bucket> envelope(const object*, size_t, size_t,
+            size_t, unsigned);
+    friend size_t read_into(const object*, numeric_type, void*, size_t, size_t);
 public:
+    // A decoded property value. String values are std::string, others
+    // the decoded C type.
     struct property{
         property(const data_type_t& dt, void* val)
             : data_type(dt),
@@ -112,118 +435,377 @@ public:
         {
         }
         property(const property& p) = delete;
-        const data_type_t data_type;
+        const data_type_t& data_type;
         void* value;
-        virtual ~property();
     };
 
-    const std::string data_type()
+    const std::string data_type() const;
+    // Numeric type of the decoded values, NONE when they aren't
+    // numbers. DAQmx channels keep the type of their scaler.
+    numeric_type decoded_type() const;
+
+    size_t bytes() const;
+
+    // Decoded values of consecutive segments
+    struct block
+    {
+        // nullptr once released
+        void* data;
+        size_t first_value;
+        size_t number_values;
+        // The data allocator had the values already
+        bool reused;
+    };
+
+    // All decoded values, kept alive while the pointer is held.
+    // Goes through the channel cache of the file if it has one, and
+    // decodes a copy when data() isn't available.
+    std::shared_ptr<const void> values() const;
+
+    // All decoded values, nullptr when they are stored in more
+    // than one block, have been released or are left to the cache
+    const void* data() const;
+
+    array_view<block> blocks() const;
+
+    // Decoded value at index, in whatever block holds it
+    const void* at(size_t index) const;
+
+    // Gives the memory of a block back, for consumers that are done
+    // with its values. The values can still be read with read_into.
+    void release_block(size_t i) const;
+
+    // Fills in objects, properties and decoded
+    memory_usage memory() const;
+
+    size_t number_values() const;
+
+    const std::string get_path() const;
+    object_handle handle() const
     {
-        return _data_type.name;
+        return object_handle{_index};
     }
 
-    size_t bytes()
+    // Name of the group or channel, without the quotes around it and
+    // with '' unescaped. Empty for the root.
+    const std::string get_name() const;
+    // The group of a channel and the root of a group, nullptr for the
+    // root
+    const object* parent() const;
+    // The groups of the root or the channels of a group, in the order
+    // they first appear in the file
+    object_range<const object> children() const;
+    // The child named name, nullptr if there is none. Takes constant
+    // time.
+    const object* child(const std::string& name) const;
+
+    // Properties are kept as raw bytes in the file contents, and
+    // decoded on every call
+    const std::map<std::string, std::shared_ptr<property>> get_properties() const;
+    // nullptr if the object doesn't have the property
+    std::shared_ptr<property> get_property(const std::string& name) const;
+private:
+    object(object_table* table, uint32_t index)
+        : _table(table),
+          _index(index)
     {
-        return _data_type.ctype_length * _number_values;
     }
+    void _initialise_data(data_allocator* allocator);
+    std::shared_ptr<const void> _decode() const;
+    // Objects are never destructed; only their decoded data needs
+    // to be given back.
+    void _release_data();
 
-    const void* data()
+    // A run of raw samples of this object inside a segment
+    struct extent
     {
-        return _data;
+        const unsigned char* data;
+        size_t stride;
+        size_t number_values;
+        numeric_type type;
+        // Bit to extract for DAQmx digital lines, -1 otherwise
+        int bit;
+        bool big_endian;
+    };
+
+    object_table* _table;
+    uint32_t _index;
+};
+
+// The objects of a file, stored column by column so a row costs a few
+// words. Properties, blocks and extents are kept in one array each,
+// grouped by object, and a row refers to its range of them. While
+// parsing they are gathered in temporary lists and grouped once the
+// metadata, and then the raw data, is read.
+class object_table
+{
+    friend class file;
+    friend class file_state;
+    friend class object;
+    friend class segment;
+    friend class segment_object;
+    friend class waveform;
+    friend class envelope_builder;
+    friend class zone_map;
+    friend class property_index;
+    template<typename T> friend class chunk_reader;
+    friend std::vector<envelope_bucket> envelope(const object*, size_t, size_t,
+            size_t, unsigned);
+    friend size_t read_into(const object*, numeric_type, void*, size_t, size_t);
+private:
+    enum flag : uint8_t
+    {
+        HAS_DATA = 1,
+        // Decoded on demand by the channel cache of the file
+        CACHED = 2,
+        // Blocks come from the data allocator, not malloc
+        ALLOCATED = 4,
+        // Not selected when opening, raw data is skipped
+        SKIPPED = 8,
+        // Not in the file, only added as a parent in the tree
+        IMPLICIT = 16
+    };
+    struct range
+    {
+        uint32_t begin;
+        uint32_t count;
+    };
+    // A property value as it is in the file contents. String values
+    // point at their length.
+    struct property_entry
+    {
+        string_ref name;
+        const data_type_t* type;
+        const unsigned char* value;
+        bool big_endian;
+    };
+    // A wf_start_time that differs from the one before, and the first
+    // value it applies to
+    struct start_time
+    {
+        uint64_t first_value;
+        property_entry value;
+    };
+
+    object_table(arena* a, channel_cache* cache);
+    object_table(const object_table&) = delete;
+
+    size_t size() const
+    {
+        return _paths.size();
     }
+    // Index of the object, added if it's new
+    uint32_t _find_or_add(string_ref path);
+    // Index of the object, or -1
+    int64_t _find(string_ref path) const;
+    // Index of the child of parent named name, or -1
+    int64_t _child(uint32_t parent, string_ref name) const;
 
-    size_t number_values()
+    // Parse time lists
+    segment_object*& _previous(uint32_t i)
     {
-        return _number_values;
+        return _parse->previous[i];
     }
+    void _add_property(uint32_t i, const property_entry& p);
+    // Adds the values of a segment to the block layout
+    void _plan_values(uint32_t i, size_t number_values, size_t block_size);
+    // Where the next number_values decoded values of i go,
+    // nullptr when they don't need decoding
+    void* _insert_values(uint32_t i, size_t number_values);
+    void _add_extent(uint32_t i, const object::extent& e);
+
+    // Groups the properties and blocks, and creates the handles. Objects
+    // select doesn't return true for are skipped.
+    void _finish_metadata(const std::function<bool (const object&)>& select);
+    // Parses the paths into the tree, adding the root and groups the
+    // file doesn't list
+    void _build_tree();
+    // Groups the extents and drops the parse time lists
+    void _finish_raw_data();
 
-    const std::string get_path()
+    array_view<property_entry> _properties_of(uint32_t i) const
     {
-        return _path;
+        return array_view<property_entry>(_properties.data() + _property_ranges[i].begin,
+                _property_ranges[i].count);
     }
-    const std::map<std::string, std::shared_ptr<property>> get_properties()
+    array_view<object::block> _blocks_of(uint32_t i) const
     {
-        return _properties;
+        return array_view<object::block>(_blocks.data() + _block_ranges[i].begin,
+                _block_ranges[i].count);
     }
-private:
-    object(const std::string& path)
-        : _path(path)
+    array_view<start_time> _start_times_of(uint32_t i) const
     {
-        _data = nullptr;
-        _number_values = 0;
-        _data_insert_position = 0;
-        _previous_segment_object = nullptr;
+        return array_view<start_time>(_start_times.data() + _start_time_ranges[i].begin,
+                _start_time_ranges[i].count);
     }
-    void _initialise_data();
-    std::shared_ptr<segment_object> _previous_segment_object;
+    array_view<object::extent> _extents_of(uint32_t i) const
+    {
+        return array_view<object::extent>(_extents.data() + _extent_ranges[i].begin,
+                _extent_ranges[i].count);
+    }
+    // Index into the extents of i of the one holding value
+    size_t _extent_at(uint32_t i, uint64_t value) const;
 
-    const std::string _path;
-    bool _has_data;
+    arena* _arena;
+    channel_cache* _cache;
+    // Where blocks of ALLOCATED objects come from
+    data_allocator* _allocator;
 
-    data_type_t _data_type;
+    arena_vector<string_ref> _paths;
+    arena_vector<const data_type_t*> _types;
+    arena_vector<uint64_t> _number_values;
+    arena_vector<uint8_t> _flags;
+    arena_vector<range> _property_ranges;
+    arena_vector<range> _block_ranges;
+    arena_vector<range> _extent_ranges;
+    arena_vector<range> _start_time_ranges;
 
-    void* _data;
-    size_t _data_insert_position;
+    arena_vector<property_entry> _properties;
+    arena_vector<start_time> _start_times;
+    arena_vector<object::block> _blocks;
+    arena_vector<object::extent> _extents;
+    // Index of the first value of every extent in its object
+    arena_vector<uint64_t> _extent_starts;
+    // Values per extent when all but the last of a row have the same
+    // number, so the extent is found by division. 0 otherwise.
+    arena_vector<uint64_t> _regular_extents;
 
-    std::map<std::string, std::shared_ptr<property>> _properties;
+    // One handle per row, and the rows ordered by path
+    object* _handles;
+    arena_vector<uint32_t> _by_path;
 
-    size_t _number_values;
+    // The unescaped name and the parent of every row, the children of
+    // every row in one array, and an open addressing hash table of rows
+    // by parent and name
+    arena_vector<string_ref> _names;
+    arena_vector<uint32_t> _parents;
+    arena_vector<range> _child_ranges;
+    arena_vector<uint32_t> _children;
+    arena_vector<uint32_t> _child_slots;
+    uint32_t _root;
 
-    ~object()
+    typedef std::pair<uint32_t, string_ref> property_key;
+    struct property_key_hash
     {
-        if(_data != nullptr)
-            free(_data);
-    }
+        size_t operator()(const property_key& k) const;
+    };
+    struct parse_state
+    {
+        std::map<string_ref, uint32_t> index;
+        // Position of a property in properties, so later segments
+        // replace the value in place
+        std::unordered_map<property_key, uint32_t, property_key_hash> property_index;
+        std::vector<segment_object*> previous;
+        std::vector<uint32_t> last_block;
+        std::vector<uint32_t> last_start_time;
+        std::vector<std::pair<uint32_t, start_time>> start_times;
+        std::vector<uint32_t> insert_block;
+        std::vector<uint64_t> insert_value;
+        std::vector<std::pair<uint32_t, property_entry>> properties;
+        std::vector<std::pair<uint32_t, object::block>> blocks;
+        std::vector<std::pair<uint32_t, object::extent>> extents;
+    };
+    std::unique_ptr<parse_state> _parse;
 };
 
+inline const std::string object::data_type() const
+{
+    return _table->_types[_index]->name;
+}
+
+inline size_t object::bytes() const
+{
+    return _table->_types[_index]->ctype_length * _table->_number_values[_index];
+}
+
+inline const void* object::data() const
+{
+    const object_table::range& r = _table->_block_ranges[_index];
+    if(r.count != 1)
+        return nullptr;
+    return _table->_blocks[r.begin].data;
+}
+
+inline array_view<object::block> object::blocks() const
+{
+    return _table->_blocks_of(_index);
+}
+
+inline size_t object::number_values() const
+{
+    return _table->_number_values[_index];
+}
+
+inline const std::string object::get_path() const
+{
+    return _table->_paths[_index].str();
+}
+
+inline const std::string object::get_name() const
+{
+    return _table->_names[_index].str();
+}
+
 class file
 {
     friend class segment;
+    friend class segment_object;
+    friend class zone_map;
 public:
-    file(const std::string& filename);
+    file(const std::string& filename,
+            const file_options& options = file_options());
+    // Moving keeps the objects where they are, so object pointers stay
+    // valid. A moved-from file can only be assigned to or destroyed.
+    file(file&& other);
+    file& operator=(file&& other);
     virtual ~file();
 
-    const object* operator[](const std::string& key);
-    class iterator
-    {
-        friend class file;
-    public:
-        object* operator*()
-        {
-            return _it->second;
-        }
-        const iterator& operator++()
-        {
-            ++_it;
+    // A parsed file to hand to any number of readers. Once opened a
+    // file doesn't change: its const members and its objects can be
+    // used from several threads without locking, apart from
+    // object::release_block, which frees values others may be reading.
+    static std::shared_ptr<const file> open(const std::string& filename,
+            const file_options& options = file_options());
 
-            return *this;
-        }
-        bool operator !=(const iterator& other)
-        {
-            return other._it != _it;
-        }
-    private:
-        iterator(std::map<std::string, object*>::iterator it)
-            : _it(it)
-        {}
-        std::map<std::string, object*>::iterator _it;
-    };
-    iterator begin()
-    {
-        return iterator(_objects.begin());
-    }
-    iterator end()
+    const object* operator[](const std::string& key) const;
+
+    // The handle of the object at path, to get to it again without
+    // looking the path up. Doesn't throw; the handle is false when
+    // there is no such object.
+    object_handle find(const std::string& path) const;
+    // The object of a handle of this file, nullptr for the false handle
+    // find returns when there is no object
+    const object* operator[](object_handle h) const
     {
-        return iterator(_objects.end());
+        return h.index < _handle_count ? _handles + h.index : nullptr;
     }
-private:
 
-    void _parse_segments();
+    // The root, the groups and the channels of a group as a tree. Paths
+    // are parsed once when opening. A root or group the file only lists
+    // children of is added to the tree, but not to the objects
+    // iterated over.
+    const object* root() const;
+    // nullptr if there is no such group or channel
+    const object* group(const std::string& name) const;
+    const object* channel(const std::string& group,
+            const std::string& name) const;
 
-    unsigned char* file_contents;
-    size_t file_contents_size;
-    std::vector<segment*> _segments;
+    // Totals over all objects and segments
+    memory_usage memory() const;
 
-    std::map<std::string, object*> _objects;
+    file(const file&) = delete;
+    file& operator=(const file&) = delete;
+
+    typedef object_iterator<object> iterator;
+    typedef object_iterator<const object> const_iterator;
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+private:
+    std::unique_ptr<file_state> _state;
+    // The handles of the object table of _state
+    const object* _handles;
+    uint32_t _handle_count;
 };
 }
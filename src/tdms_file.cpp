@@ -3,52 +3,122 @@
 #include <cstring>
 #include <cstdint>
 #include <map>
+#include <new>
+#include <string>
+#include <algorithm>
+#include <limits>
+
+#include <sys/stat.h>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 
 #include "tdms.hpp"
 #include "log.hpp"
 #include "tdms_impl.hpp"
+#include "mapped_storage.hpp"
 
 namespace TDMS
 {
 
-file::file(const std::string& filename)
+file_state::file_state(const std::string& filename, const file_options& options)
+    : _options(options),
+      file_contents(nullptr),
+      file_contents_size(0),
+      file_contents_mtime(0),
+      _metadata(options.metadata_resource),
+      _segments(arena_allocator<segment*>(&_metadata)),
+      _objects(&_metadata, options.cache)
 {
-    // Read file into memory
-    FILE* f = fopen(filename.c_str(), "r");
+    // The file contents stay around for the lifetime of the file,
+    // so values can be read straight from the raw segment data.
+#if !defined(_WIN32)
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        throw std::runtime_error("File \"" + filename + "\" could not be opened");
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("File \"" + filename + "\" could not be read");
+    }
+    file_contents_size = st.st_size;
+    file_contents_mtime = st.st_mtime;
+    if(file_contents_size > 0)
+    {
+        void* m = mmap(nullptr, file_contents_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(m == MAP_FAILED)
+        {
+            close(fd);
+            throw std::runtime_error("File \"" + filename + "\" could not be mapped");
+        }
+        file_contents = (unsigned char*) m;
+    }
+    close(fd);
+#else
+    FILE* f = fopen(filename.c_str(), "rb");
     if(!f)
     {
         throw std::runtime_error("File \"" + filename + "\" could not be opened");
     }
+    struct stat st;
+    if(stat(filename.c_str(), &st) == 0)
+        file_contents_mtime = st.st_mtime;
     fseek(f, 0, SEEK_END);
     file_contents_size = ftell(f);
     fseek(f, 0, SEEK_SET);
 
-    file_contents = (unsigned char*) malloc(file_contents_size * sizeof(unsigned char*));
+    file_contents = (unsigned char*) malloc(file_contents_size);
 
     size_t read = fread(file_contents, file_contents_size, 1, f);
     fclose(f);
-    if(read != 1)
+    if(read != 1 && file_contents_size > 0)
     {
+        free(file_contents);
         throw std::runtime_error("File \"" + filename + "\" could not be read");
     }
+#endif
 
     // Now parse the segments
-    _parse_segments();
-
-    file_contents_size = 0;
-    free(file_contents);
+    try
+    {
+        if(!_options.decode_directory.empty())
+        {
+            if(_options.allocator != nullptr)
+            {
+                throw std::invalid_argument("A decode directory can't be "
+                        "combined with a data allocator");
+            }
+            _mapped.reset(new mapped_allocator(_options.decode_directory,
+                        filename, _options.keep_decoded));
+            _options.allocator = _mapped.get();
+        }
+        _parse_segments();
+        if(_mapped)
+            _mapped->commit();
+    }
+    catch(...)
+    {
+        _release();
+        throw;
+    }
 }
 
-void file::_parse_segments()
+void file_state::_parse_segments()
 {
     size_t offset = 0;
     segment* prev = nullptr;
     // First read the metadata of the segments
-    while(offset < file_contents_size - 8*4)
+    while(offset + 7*4 <= file_contents_size)
     {
         try
         {
-            segment* s = new segment(file_contents + offset, prev, this);
+            segment* s = new (_metadata.allocate(sizeof(segment), alignof(segment)))
+                segment(file_contents + offset, prev, this);
             offset += s->_next_segment_offset;
             _segments.push_back(s);
             prev = s;
@@ -59,56 +129,373 @@ void file::_parse_segments()
             break;
         }
     }
-    for(auto obj: this->_objects)
+    _objects._finish_metadata(_options.select);
+    _objects._allocator = _options.allocator;
+    for(size_t i = 0; i < _objects.size(); ++i)
     {
-        obj.second->_initialise_data();
+        object& o = _objects._handles[i];
+        if(_objects._flags[i] & object_table::SKIPPED)
+            continue;
+        if(_options.cache != nullptr
+                && o.decoded_type() != numeric_type::NONE)
+            _objects._flags[i] |= object_table::CACHED;
+        else
+            o._initialise_data(_options.allocator);
     }
     for(auto seg: this->_segments)
     {
         seg->_parse_raw_data();
     }
+    _objects._finish_raw_data();
 }
 
-const object* file::operator[](const std::string& key)
+file_state::~file_state()
 {
-    return _objects.at(key);
+    _release();
+}
+
+void file_state::_release()
+{
+    // Everything else lives in the arena, which goes all at once.
+    // Without handles the metadata wasn't complete and nothing was
+    // decoded yet.
+    for(size_t i = 0; _objects._handles != nullptr && i < _objects.size(); ++i)
+    {
+        if(_objects._flags[i] & object_table::CACHED)
+            _objects._cache->_forget(_objects._handles + i);
+        _objects._handles[i]._release_data();
+    }
+    _objects._parse.reset();
+    _metadata.release();
+    if(file_contents == nullptr)
+        return;
+#if !defined(_WIN32)
+    munmap(file_contents, file_contents_size);
+#else
+    free(file_contents);
+#endif
+    file_contents = nullptr;
+    file_contents_size = 0;
+}
+
+std::function<bool (const object& o)> select_paths(
+        const std::vector<std::string>& paths)
+{
+    std::vector<std::string> sorted(paths);
+    std::sort(sorted.begin(), sorted.end());
+    return [sorted](const object& o){
+        return std::binary_search(sorted.begin(), sorted.end(), o.get_path());
+    };
+}
+
+namespace
+{
+
+bool glob_match(const char* pattern, const char* s, const char* end)
+{
+    // Backtracks to the last * only, which is enough without classes
+    const char* star = nullptr;
+    const char* resume = nullptr;
+    while(s != end)
+    {
+        if(*pattern == '*')
+        {
+            star = ++pattern;
+            resume = s;
+        }
+        else if(*pattern != '\0' && (*pattern == '?' || *pattern == *s))
+        {
+            ++pattern;
+            ++s;
+        }
+        else if(star != nullptr)
+        {
+            pattern = star;
+            s = ++resume;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while(*pattern == '*')
+        ++pattern;
+    return *pattern == '\0';
+}
+
+}
+
+std::function<bool (const object& o)> select_glob(const std::string& pattern)
+{
+    return [pattern](const object& o){
+        std::string path = o.get_path();
+        return glob_match(pattern.c_str(), path.data(), path.data() + path.size());
+    };
+}
+
+file::file(const std::string& filename, const file_options& options)
+    : _state(new file_state(filename, options)),
+      _handles(_state->_objects._handles),
+      _handle_count(uint32_t(_state->_objects.size()))
+{
+}
+
+file::file(file&& other)
+    : _state(std::move(other._state)),
+      _handles(other._handles),
+      _handle_count(other._handle_count)
+{
+    other._handles = nullptr;
+    other._handle_count = 0;
+}
+
+file& file::operator=(file&& other)
+{
+    if(this == &other)
+        return *this;
+    _state = std::move(other._state);
+    _handles = other._handles;
+    _handle_count = other._handle_count;
+    other._handles = nullptr;
+    other._handle_count = 0;
+    return *this;
 }
 
 file::~file()
 {
-    for(segment* _s : _segments)
-        delete _s;
-    for(auto _o : _objects)
-        delete _o.second;
 }
 
-void object::_initialise_data()
+std::shared_ptr<const file> file::open(const std::string& filename,
+        const file_options& options)
 {
-    if(_number_values == 0)
-        return;
-    size_t s = _number_values * _data_type.ctype_length;
-    log::debug << "Assigned " << s << " bytes for object " << _path << "#values" << _number_values << "*type" << _data_type.ctype_length << log::endl;
-    _data = malloc(s);
-    this->_data_insert_position = 0;
+    return std::make_shared<const file>(filename, options);
+}
+
+const object* file::operator[](const std::string& key) const
+{
+    const object_table& objects = _state->_objects;
+    int64_t i = objects._find(string_ref(key));
+    if(i < 0)
+        throw std::out_of_range("No object " + key);
+    return objects._handles + i;
+}
+
+const object* file::root() const
+{
+    const object_table& objects = _state->_objects;
+    return objects._handles + objects._root;
 }
 
-object::property::~property()
+const object* file::group(const std::string& name) const
 {
-    if(value == nullptr) 
+    return root()->child(name);
+}
+
+const object* file::channel(const std::string& group,
+        const std::string& name) const
+{
+    const object* g = root()->child(group);
+    return g != nullptr ? g->child(name) : nullptr;
+}
+
+object_handle file::find(const std::string& path) const
+{
+    int64_t i = _state->_objects._find(string_ref(path));
+    if(i < 0)
+        return object_handle{object_handle::none};
+    return object_handle{uint32_t(i)};
+}
+
+file::iterator file::begin()
+{
+    const object_table& objects = _state->_objects;
+    return iterator(objects._handles, objects._by_path.data());
+}
+
+file::iterator file::end()
+{
+    const object_table& objects = _state->_objects;
+    return iterator(objects._handles,
+            objects._by_path.data() + objects._by_path.size());
+}
+
+file::const_iterator file::begin() const
+{
+    const object_table& objects = _state->_objects;
+    return const_iterator(objects._handles, objects._by_path.data());
+}
+
+file::const_iterator file::end() const
+{
+    const object_table& objects = _state->_objects;
+    return const_iterator(objects._handles,
+            objects._by_path.data() + objects._by_path.size());
+}
+
+const object* object::parent() const
+{
+    uint32_t p = _table->_parents[_index];
+    if(p == std::numeric_limits<uint32_t>::max())
+        return nullptr;
+    return _table->_handles + p;
+}
+
+object_range<const object> object::children() const
+{
+    const object_table::range& r = _table->_child_ranges[_index];
+    const uint32_t* rows = _table->_children.data() + r.begin;
+    return object_range<const object>(
+            object_iterator<const object>(_table->_handles, rows),
+            object_iterator<const object>(_table->_handles, rows + r.count));
+}
+
+const object* object::child(const std::string& name) const
+{
+    int64_t i = _table->_child(_index, string_ref(name));
+    return i < 0 ? nullptr : _table->_handles + i;
+}
+
+void object::_initialise_data(data_allocator* allocator)
+{
+    const data_type_t* type = _table->_types[_index];
+    const object_table::range& r = _table->_block_ranges[_index];
+    for(uint32_t i = r.begin; i < r.begin + r.count; ++i)
     {
-        log::debug << "DOUBLE FREE" << log::endl;
-        return;
+        block& b = _table->_blocks[i];
+        size_t s = b.number_values * type->ctype_length;
+        log::debug << "Assigned " << s << " bytes for object " << get_path() << "#values" << b.number_values << "*type" << type->ctype_length << log::endl;
+        bool allocated = (_table->_flags[_index] & object_table::ALLOCATED) != 0;
+        if(allocator != nullptr && (allocated || i == r.begin))
+        {
+            b.data = allocator->allocate(*this, s);
+            if(b.data != nullptr)
+            {
+                _table->_flags[_index] |= object_table::ALLOCATED;
+                b.reused = allocator->holds_values(*this, b.data);
+                continue;
+            }
+            if(allocated)
+            {
+                throw std::bad_alloc();
+            }
+        }
+        b.data = malloc(s);
+        if(b.data == nullptr)
+        {
+            throw std::bad_alloc();
+        }
     }
-    if(data_type.name == "tdsTypeString")
+}
+
+const std::map<std::string, std::shared_ptr<object::property>> object::get_properties() const
+{
+    std::map<std::string, std::shared_ptr<property>> properties;
+    for(const object_table::property_entry& p : _table->_properties_of(_index))
     {
-        delete (std::string*) value;
+        properties.emplace(p.name.str(), segment_object::_read_property(p));
     }
+    return properties;
+}
+
+std::shared_ptr<object::property> object::get_property(const std::string& name) const
+{
+    array_view<object_table::property_entry> properties = _table->_properties_of(_index);
+    string_ref key(name);
+    const object_table::property_entry* it = std::lower_bound(properties.begin(),
+            properties.end(), key,
+            [](const object_table::property_entry& p, const string_ref& k){
+                return p.name < k;
+            });
+    if(it == properties.end() || it->name != key)
+        return nullptr;
+    return segment_object::_read_property(*it);
+}
+
+const void* object::at(size_t index) const
+{
+    if(index >= number_values())
+    {
+        throw std::out_of_range("Value " + std::to_string(index)
+                + " is past the end of object " + get_path());
+    }
+    if(_table->_flags[_index] & object_table::SKIPPED)
+    {
+        throw std::runtime_error("Object " + get_path()
+                + " wasn't selected when opening");
+    }
+    array_view<block> b = blocks();
+    const block* it = std::upper_bound(b.begin(), b.end(), index,
+            [](size_t i, const block& b){
+                return i < b.first_value;
+            });
+    --it;
+    if(it->data == nullptr)
+    {
+        throw std::runtime_error("Value " + std::to_string(index)
+                + " of object " + get_path() + " has been released");
+    }
+    return (const unsigned char*)it->data
+        + (index - it->first_value) * _table->_types[_index]->ctype_length;
+}
+
+void object::release_block(size_t i) const
+{
+    const object_table::range& r = _table->_block_ranges[_index];
+    if(i >= r.count)
+        throw std::out_of_range("No block " + std::to_string(i));
+    block& b = _table->_blocks[r.begin + i];
+    if(b.data == nullptr)
+        return;
+    if(_table->_flags[_index] & object_table::ALLOCATED)
+        _table->_allocator->deallocate(*this, b.data,
+                b.number_values * _table->_types[_index]->ctype_length);
     else
+        free(b.data);
+    b.data = nullptr;
+}
+
+numeric_type object::decoded_type() const
+{
+    const data_type_t* type = _table->_types[_index];
+    if(type->numeric == numeric_type::EXTENDED)
+        return numeric_type::FLOAT64;
+    return type->numeric;
+}
+
+std::shared_ptr<const void> object::_decode() const
+{
+    numeric_type t = decoded_type();
+    if(t == numeric_type::NONE)
     {
-        free(value);
+        throw std::runtime_error("The values of object " + get_path()
+                + " can't be decoded again");
     }
-    value = nullptr;
+    void* d = malloc(bytes());
+    if(d == nullptr && bytes() != 0)
+    {
+        throw std::bad_alloc();
+    }
+    std::shared_ptr<const void> values(d, free);
+    read_into(this, t, d, 0, number_values());
+    return values;
+}
+
+std::shared_ptr<const void> object::values() const
+{
+    if(_table->_flags[_index] & object_table::CACHED)
+        return _table->_cache->_get(this);
+    const void* d = data();
+    if(d != nullptr || number_values() == 0)
+        return std::shared_ptr<const void>(d, [](const void*){});
+    return _decode();
 }
+
+void object::_release_data()
+{
+    for(size_t i = 0; i < _table->_block_ranges[_index].count; ++i)
+        release_block(i);
+}
+
 void data_type_t::_init_default_array_reader()
 {
     auto read_to = this->read_to;
@@ -5,12 +5,19 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <stdexcept>
+
+#include "decode_kernels.hpp"
+#include "arena.hpp"
+#include "tdms.hpp"
 
 namespace TDMS
 {
 
 class file;
+class file_state;
 class object;
+class object_table;
 class segment_object;
 
 enum endianness
@@ -22,6 +29,7 @@ enum endianness
 class segment
 {
     friend class file;
+    friend class file_state;
     friend class object;
     friend class segment_object;
 private:
@@ -35,10 +43,21 @@ private:
     };
     typedef segment_object object;
 
+    enum toc_flag : int32_t
+    {
+        kTocMetaData = int32_t(1) << 1,
+        kTocNewObjList = int32_t(1) << 2,
+        kTocRawData = int32_t(1) << 3,
+        kTocInterleavedData = int32_t(1) << 5,
+        kTocBigEndian = int32_t(1) << 6,
+        kTocDAQmxRawData = int32_t(1) << 7
+    };
+
+    // Segments live in the metadata arena of their file
+    // and are never destructed.
     segment(const unsigned char* file_contents, 
             segment* previous_segment,
-            file* file);
-    virtual ~segment();
+            file_state* file);
 
     void _parse_metadata(const unsigned char* data, 
             segment* previous_segment);
@@ -48,37 +67,101 @@ private:
     size_t _offset;
     size_t _chunk_count;
 
-    // Probably a map using enums performs faster.
-    // Will only give a little performance though.
-    // Perhaps use a struct for the _toc, so we don't need
-    // the std::map and don't have to do lookups.
-    std::map<std::string, bool> _toc;
+    bool _has(toc_flag flag) const
+    {
+        return (_toc & flag) != 0;
+    }
+
+    int32_t _toc;
     const unsigned char* _data;
     size_t _next_segment_offset;
     size_t _raw_data_offset;
     size_t _num_chunks;
-    std::vector<std::shared_ptr<segment::object>> _ordered_objects;
+    endianness _endianness;
+    // All DAQmx objects of a segment share the same raw buffers,
+    // so their data size is only counted once per chunk.
+    size_t _daqmx_chunk_size;
+    arena_vector<segment::object*> _ordered_objects;
 
-    file* _parent_file;
+    file_state* _parent_file;
 
     static const std::map<const std::string, int32_t> _toc_properties;
 };
 
 class segment_object
 {
+    friend class file;
+    friend class file_state;
     friend class segment;
     friend class object;
 private:
-    segment_object(object* o);
-    const unsigned char* _parse_metadata(const unsigned char* data);
-    void _read_values(const unsigned char*& data, endianness e);
-    object* _tdms_object;
+    segment_object(object_table* table, uint32_t o, arena* a);
+    const unsigned char* _parse_metadata(const unsigned char* data,
+            endianness e);
+    const unsigned char* _parse_daqmx_metadata(const unsigned char* data,
+            uint32_t raw_data_index, endianness e);
+    void _read_values(const unsigned char* data, size_t stride, endianness e);
+    static std::shared_ptr<object::property> _read_property(
+            const object_table::property_entry& p);
+    void _read_daqmx_values(const unsigned char* chunk, endianness e);
+    object_table* _table;
+    // Row of the object in the table
+    uint32_t _object;
+
+    struct daqmx_scaler
+    {
+        numeric_type data_type;
+        uint32_t raw_buffer_index;
+        // Bit offset for digital line scalers
+        uint32_t raw_byte_offset;
+        uint32_t sample_format_bitmap;
+        uint32_t scale_id;
+    };
+    bool _is_daqmx;
+    bool _daqmx_digital_line;
+    arena_vector<daqmx_scaler> _daqmx_scalers;
+    arena_vector<uint32_t> _daqmx_raw_data_widths;
 
     uint64_t _number_values;
     uint64_t _data_size;
     bool _has_data;
     uint32_t _dimension;
-    data_type_t _data_type;
+    const data_type_t* _data_type;
     //_dimension;
 };
+// Everything a file owns. It lives on the heap, so a file can be
+// moved without moving the objects, the arena or the mapping.
+class file_state
+{
+    friend class file;
+    friend class segment;
+    friend class segment_object;
+    friend class zone_map;
+public:
+    file_state(const std::string& filename, const file_options& options);
+    ~file_state();
+    file_state(const file_state&) = delete;
+    file_state& operator=(const file_state&) = delete;
+private:
+
+    void _parse_segments();
+    void _release();
+
+    file_options _options;
+
+    unsigned char* file_contents;
+    size_t file_contents_size;
+    // Modification time of the file when it was opened
+    int64_t file_contents_mtime;
+
+    // All metadata: segments, objects and their properties. Property
+    // names and values stay in the file contents.
+    arena _metadata;
+    arena_vector<segment*> _segments;
+    object_table _objects;
+
+    // Allocator for decode_directory
+    std::unique_ptr<mapped_allocator> _mapped;
+};
+
 }
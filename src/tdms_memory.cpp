@@ -0,0 +1,73 @@
+#include <set>
+#include <string>
+
+#include "tdms.hpp"
+#include "tdms_impl.hpp"
+
+namespace TDMS
+{
+
+memory_usage object::memory() const
+{
+    const object_table& t = *_table;
+    memory_usage m;
+    // The row in every column, the handle, the position by path and
+    // the place in the tree. The child hash table is counted by the file.
+    m.objects = sizeof(string_ref) + sizeof(const data_type_t*)
+        + sizeof(uint64_t) + sizeof(uint8_t) + 5 * sizeof(object_table::range)
+        + sizeof(object) + sizeof(uint32_t)
+        + sizeof(string_ref) + 2 * sizeof(uint32_t)
+        + t._paths[_index].size
+        + sizeof(uint64_t)
+        + t._extent_ranges[_index].count * (sizeof(extent) + sizeof(uint64_t))
+        + t._block_ranges[_index].count * sizeof(block);
+    // Property names and values are read from the file contents
+    m.properties = t._property_ranges[_index].count
+        * sizeof(object_table::property_entry)
+        + t._start_time_ranges[_index].count * sizeof(object_table::start_time);
+    for(const block& b : blocks())
+    {
+        if(b.data != nullptr)
+            m.decoded += b.number_values * t._types[_index]->ctype_length;
+    }
+    if(t._flags[_index] & object_table::CACHED)
+        m.decoded += t._cache->_bytes_of(this);
+    return m;
+}
+
+memory_usage file::memory() const
+{
+    const file_state& f = *_state;
+    memory_usage m;
+    for(size_t i = 0; i < f._objects.size(); ++i)
+    {
+        memory_usage om = f._objects._handles[i].memory();
+        m.objects += om.objects;
+        m.properties += om.properties;
+        m.decoded += om.decoded;
+    }
+    m.objects += f._objects._child_slots.capacity() * sizeof(uint32_t);
+
+    // Segments share the segment objects that didn't change
+    std::set<const segment_object*> segment_objects;
+    m.segments = f._segments.capacity() * sizeof(segment*);
+    for(const segment* s : f._segments)
+    {
+        m.segments += sizeof(segment)
+            + s->_ordered_objects.capacity() * sizeof(segment_object*);
+        for(const segment_object* so : s->_ordered_objects)
+        {
+            if(!segment_objects.insert(so).second)
+                continue;
+            m.segments += sizeof(segment_object)
+                + so->_daqmx_scalers.capacity() * sizeof(segment_object::daqmx_scaler)
+                + so->_daqmx_raw_data_widths.capacity() * sizeof(uint32_t);
+        }
+    }
+
+    m.arena_reserved = f._metadata.bytes_reserved();
+    m.mapped = f.file_contents_size;
+    return m;
+}
+
+}
@@ -0,0 +1,76 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include "tdms.hpp"
+#include "decode_kernels.hpp"
+
+namespace TDMS
+{
+
+size_t read_into(const object* o, numeric_type t, void* target,
+        size_t start, size_t count)
+{
+    size_t number_values = o->number_values();
+    if(start > number_values)
+    {
+        throw std::out_of_range("Reading past the end of object " + o->get_path());
+    }
+    size_t target_size = numeric_type_size(t);
+    if(target_size == 0 || t == numeric_type::EXTENDED)
+    {
+        throw std::invalid_argument("Can't read into this numeric type");
+    }
+    count = std::min(count, number_values - start);
+    if(o->_table->_flags[o->_index] & object_table::SKIPPED)
+    {
+        throw std::runtime_error("Object " + o->get_path()
+                + " wasn't selected when opening");
+    }
+
+    unsigned char* out = (unsigned char*) target;
+    size_t done = 0;
+    const object_table& table = *o->_table;
+    array_view<object::extent> extents = table._extents_of(o->_index);
+    if(extents.empty())
+        return 0;
+    size_t x = table._extent_at(o->_index, start);
+    start -= table._extent_starts[table._extent_ranges[o->_index].begin + x];
+    for(; x < extents.size() && done < count; ++x)
+    {
+        const object::extent& e = extents[x];
+        size_t n = std::min(e.number_values - start, count - done);
+        const unsigned char* source = e.data + start*e.stride;
+        if(e.bit >= 0)
+        {
+            // Digital lines go through a small buffer of doubles
+            kernels::convert_t convert = kernels::converter(
+                    numeric_type::FLOAT64, t);
+            const size_t block = 256;
+            double tmp[block];
+            for(size_t i = 0; i < n; i += block)
+            {
+                size_t m = std::min(block, n - i);
+                kernels::extract_bits(source + i*e.stride, e.stride, e.bit,
+                        tmp, m);
+                convert((const unsigned char*) tmp, sizeof(double),
+                        out + (done + i)*target_size, m);
+            }
+        }
+        else
+        {
+            kernels::convert_t convert = kernels::converter(e.type, t,
+                    e.big_endian);
+            if(convert == nullptr)
+            {
+                throw std::runtime_error("Object " + o->get_path()
+                        + " doesn't hold numeric data");
+            }
+            convert(source, e.stride, out + done*target_size, n);
+        }
+        done += n;
+        start = 0;
+    }
+    return done;
+}
+
+}
@@ -33,49 +33,94 @@ inline std::function<void (const unsigned char*, void*)> put_on_heap_generator(s
     };
 }
 
-template<typename T>
-inline std::function<void (const unsigned char*, void*)> put_le_on_heap_generator()
-{
-    return put_on_heap_generator<T>(&read_le<T>);
-}
-
-template<typename T>
-inline std::function<void (const unsigned char*, void*, size_t)> copy_array_reader_generator()
-{
-    return [](const unsigned char* source, void* tgt, size_t number_values){
-        memcpy(tgt, source, number_values*sizeof(T));
-    };
-}
-
 std::function<void (const unsigned char*, void*)> not_implemented = [](const unsigned char*, void*){throw std::runtime_error{"Reading this type is not implemented. Aborting"};};
 
 const std::map<uint32_t, const data_type_t> data_type_t::_tds_datatypes = {
     {         0, data_type_t("tdsTypeVoid", 0, not_implemented)},
-    {         1, data_type_t("tdsTypeI8",  1, put_le_on_heap_generator<int8_t>(), copy_array_reader_generator<int8_t>())},
-    {         2, data_type_t("tdsTypeI16", 2, put_le_on_heap_generator<int16_t>())},
-    {         3, data_type_t("tdsTypeI32", 4, put_le_on_heap_generator<int32_t>())},
-    {         4, data_type_t("tdsTypeI64", 8, put_le_on_heap_generator<int32_t>())},
-    {         5, data_type_t("tdsTypeU8",  1, put_le_on_heap_generator<uint8_t>())},
-    {         6, data_type_t("tdsTypeU16", 2, put_le_on_heap_generator<uint16_t>())},
-    {         7, data_type_t("tdsTypeU32", 4, put_le_on_heap_generator<uint32_t>())},
-    {         8, data_type_t("tdsTypeU64", 8, put_le_on_heap_generator<uint64_t>())},
-    {         9, data_type_t("tdsTypeSingleFloat", 4, put_on_heap_generator<float>(&read_le_float), copy_array_reader_generator<float>())},
-    {        10, data_type_t("tdsTypeDoubleFloat", 8, put_on_heap_generator<double>(&read_le_double), copy_array_reader_generator<double>())},
-    {        11, data_type_t("tdsTypeExtendedFloat", 0,not_implemented)},
-    {        12, data_type_t("tdsTypeDoubleFloatWithUnit", 8, not_implemented)},
-    {        13, data_type_t("tdsTypeExtendedFloatWithUnit", 0, not_implemented)},
-    {      0x19, data_type_t("tdsTypeSingleFloatWithUnit", 4, not_implemented)},
+    {         1, data_type_t("tdsTypeI8",  numeric_type::INT8)},
+    {         2, data_type_t("tdsTypeI16", numeric_type::INT16)},
+    {         3, data_type_t("tdsTypeI32", numeric_type::INT32)},
+    {         4, data_type_t("tdsTypeI64", numeric_type::INT64)},
+    {         5, data_type_t("tdsTypeU8",  numeric_type::UINT8)},
+    {         6, data_type_t("tdsTypeU16", numeric_type::UINT16)},
+    {         7, data_type_t("tdsTypeU32", numeric_type::UINT32)},
+    {         8, data_type_t("tdsTypeU64", numeric_type::UINT64)},
+    {         9, data_type_t("tdsTypeSingleFloat", numeric_type::FLOAT32)},
+    {        10, data_type_t("tdsTypeDoubleFloat", numeric_type::FLOAT64)},
+    {        11, data_type_t("tdsTypeExtendedFloat", numeric_type::EXTENDED)},
+    {        12, data_type_t("tdsTypeDoubleFloatWithUnit", numeric_type::FLOAT64)},
+    {        13, data_type_t("tdsTypeExtendedFloatWithUnit", numeric_type::EXTENDED)},
+    {      0x19, data_type_t("tdsTypeSingleFloatWithUnit", numeric_type::FLOAT32)},
     {      0x20, data_type_t("tdsTypeString", 0, not_implemented)},
-    {      0x21, data_type_t("tdsTypeBoolean", 1, not_implemented)},
-    {      0x44, data_type_t("tdsTypeTimeStamp", 16, put_on_heap_generator<time_t>(&read_timestamp))},
-    {0xFFFFFFFF, data_type_t("tdsTypeDAQmxRawData", 0, not_implemented)}
+    {      0x21, data_type_t("tdsTypeBoolean", numeric_type::UINT8)},
+    {      0x44, data_type_t("tdsTypeTimeStamp", 16, &read_timestamp)},
+    // DAQmx channels take the type of their scaler, from daqmx_raw_data_types
+    {0xFFFFFFFF, data_type_t("tdsTypeDAQmxRawData", 0, 0, not_implemented)}
 };
 
+const std::map<numeric_type, const data_type_t> daqmx_raw_data_types = {
+    {numeric_type::INT8,    data_type_t("tdsTypeDAQmxRawData", numeric_type::INT8)},
+    {numeric_type::INT16,   data_type_t("tdsTypeDAQmxRawData", numeric_type::INT16)},
+    {numeric_type::INT32,   data_type_t("tdsTypeDAQmxRawData", numeric_type::INT32)},
+    {numeric_type::INT64,   data_type_t("tdsTypeDAQmxRawData", numeric_type::INT64)},
+    {numeric_type::UINT8,   data_type_t("tdsTypeDAQmxRawData", numeric_type::UINT8)},
+    {numeric_type::UINT16,  data_type_t("tdsTypeDAQmxRawData", numeric_type::UINT16)},
+    {numeric_type::UINT32,  data_type_t("tdsTypeDAQmxRawData", numeric_type::UINT32)},
+    {numeric_type::UINT64,  data_type_t("tdsTypeDAQmxRawData", numeric_type::UINT64)},
+    {numeric_type::FLOAT32, data_type_t("tdsTypeDAQmxRawData", numeric_type::FLOAT32)},
+    {numeric_type::FLOAT64, data_type_t("tdsTypeDAQmxRawData", numeric_type::FLOAT64)}
+};
+
+const data_type_t data_type_t::_invalid_datatype;
+
+data_type_t::data_type_t(const std::string& _name, numeric_type t)
+    : name(_name),
+      length(numeric_type_size(t)),
+      numeric(t)
+{
+    numeric_type decoded = (t == numeric_type::EXTENDED) ? numeric_type::FLOAT64 : t;
+    ctype_length = numeric_type_size(decoded);
+    // Look the kernel up on every call, so the active kernels can change
+    size_t stride = length;
+    read_to = [t, decoded, stride](const unsigned char* source, void* target){
+        kernels::converter(t, decoded)(source, stride, target, 1);
+    };
+    read_array_to = [t, decoded, stride](const unsigned char* source, void* target, size_t number_values){
+        kernels::converter(t, decoded)(source, stride, target, number_values);
+    };
+}
+
+// Raw data index values announcing DAQmx metadata
+const uint32_t daqmx_format_changing_scaler = 0x00001269;
+const uint32_t daqmx_digital_line_scaler = 0x0000126A;
+
+numeric_type daqmx_data_type(uint32_t code)
+{
+    switch(code)
+    {
+    case 0: return numeric_type::UINT8;
+    case 1: return numeric_type::INT8;
+    case 2: return numeric_type::UINT16;
+    case 3: return numeric_type::INT16;
+    case 4: return numeric_type::UINT32;
+    case 5: return numeric_type::INT32;
+    case 6: return numeric_type::UINT64;
+    case 7: return numeric_type::INT64;
+    case 8: return numeric_type::FLOAT32;
+    case 9: return numeric_type::FLOAT64;
+    default:
+        throw std::runtime_error("Unsupported DAQmx scaler data type");
+    }
+}
+
 
 segment::segment(const unsigned char* contents, 
         segment* previous_segment,
-        file* file)
-    : _parent_file(file)
+        file_state* file)
+    : _endianness(LITTLE),
+      _daqmx_chunk_size(0),
+      _ordered_objects(arena_allocator<segment::object*>(&file->_metadata)),
+      _parent_file(file)
 {
     const char* header = "TDSm";
     if(memcmp(contents, header, 4) != 0)
@@ -85,18 +130,23 @@ segment::segment(const unsigned char* contents,
     contents += 4;
 
     // First four bytes are toc mask
-    int32_t toc_mask = read_le<int32_t>(contents);
+    _toc = read_le<int32_t>(contents);
     
     for(auto prop : segment::_toc_properties)
     {
-        _toc[prop.first] = (toc_mask & prop.second) != 0;
         log::debug << "Property " << prop.first << " is " 
-             << _toc[prop.first] << log::endl;
+             << ((_toc & prop.second) != 0) << log::endl;
     }
     contents += 4;
+
+    // The toc mask is always little endian, the rest of the segment
+    // follows kTocBigEndian.
+    if(_has(kTocBigEndian))
+        _endianness = BIG;
+    endianness e = _endianness;
     
     // Four bytes for version number
-    int32_t version = read_le<int32_t>(contents);
+    int32_t version = read_number<int32_t>(contents, e);
     log::debug << "Version: " << version << log::endl;
     switch (version)
     {
@@ -111,9 +161,9 @@ segment::segment(const unsigned char* contents,
     
     // 64 bits pointer to next segment
     // and same for raw data offset
-    uint64_t next_segment_offset = read_le<uint64_t>(contents);
+    uint64_t next_segment_offset = read_number<uint64_t>(contents, e);
     contents += 8;
-    uint64_t raw_data_offset = read_le<uint64_t>(contents);
+    uint64_t raw_data_offset = read_number<uint64_t>(contents, e);
     contents += 8;
 
     this->_data = contents + raw_data_offset; // Remember location of the data
@@ -132,7 +182,8 @@ segment::segment(const unsigned char* contents,
 void segment::_parse_metadata(const unsigned char* data, 
         segment* previous_segment)
 {
-    if(!this->_toc["kTocMetaData"])
+    endianness e = _endianness;
+    if(!this->_has(kTocMetaData))
     {
         if(previous_segment == nullptr)
             throw std::runtime_error("kTocMetaData is set for segment, but"
@@ -141,7 +192,7 @@ void segment::_parse_metadata(const unsigned char* data,
         _calculate_chunks();
         return;
     }
-    if(!this->_toc["kTocNewObjList"])
+    if(!this->_has(kTocNewObjList))
     {
         // In this case, there can be a list of new objects that
         // are appended, or previous objects can also be repeated
@@ -154,38 +205,30 @@ void segment::_parse_metadata(const unsigned char* data,
     }
 
     // Read number of metadata objects
-    int32_t num_objs = read_le<int32_t>(data);
+    int32_t num_objs = read_number<int32_t>(data, e);
     data += 4;
 
+    arena& metadata = _parent_file->_metadata;
     for(size_t i = 0; i < num_objs; ++i)
     {
-        std::string object_path = read_string(data);
-        data += 4 + object_path.size();
-        log::debug << object_path << log::endl;
+        string_ref object_path = read_string_ref(data, e);
+        data += 4 + object_path.size;
+        log::debug << object_path.str() << log::endl;
 
-        TDMS::object* obj = nullptr;
-        if(_parent_file->_objects.find(object_path) 
-                != _parent_file->_objects.end())
-        {
-            obj = _parent_file->_objects[object_path];
-        }
-        else
-        {
-            obj = new TDMS::object(object_path);
-            _parent_file->_objects[object_path] = obj;
-        }
+        object_table& objects = _parent_file->_objects;
+        uint32_t obj = objects._find_or_add(object_path);
         bool updating_existing = false;
 
-        std::shared_ptr<segment::object> segment_object(nullptr);
+        segment::object* segment_object = nullptr;
 
-        if(!_toc["kTocNewObjList"])
+        if(!_has(kTocNewObjList))
         {
             // Search for the same object from the previous
             // segment object list
             auto it = std::find_if(this->_ordered_objects.begin(),
                     this->_ordered_objects.end(),
-                    [obj](const std::shared_ptr<segment::object> o){
-                        return (o->_tdms_object == obj);
+                    [obj](const segment::object* o){
+                        return (o->_object == obj);
                         // TODO: compare by value?
                         //       define an operator==() ?
                     });
@@ -193,24 +236,30 @@ void segment::_parse_metadata(const unsigned char* data,
             {
                 updating_existing = true;
                 log::debug << "Updating object in segment list." << log::endl;
-                segment_object = *it;
+                // The list is copied from the previous segment, which
+                // must keep its own version of the object.
+                segment_object = new (metadata.allocate(sizeof(segment::object),
+                            alignof(segment::object))) segment::object(**it);
+                *it = segment_object;
             }
         }
         if(!updating_existing)
         {
-            if(obj->_previous_segment_object != nullptr)
+            void* p = metadata.allocate(sizeof(segment::object),
+                    alignof(segment::object));
+            if(objects._previous(obj) != nullptr)
             {
                 log::debug << "Copying previous segment object" << log::endl;
-                segment_object = std::make_shared<segment::object>(*obj->_previous_segment_object);
+                segment_object = new (p) segment::object(*objects._previous(obj));
             }
             else
             {
-                segment_object = std::shared_ptr<segment::object>(new segment::object(obj));
+                segment_object = new (p) segment::object(&objects, obj, &metadata);
             }
             this->_ordered_objects.push_back(segment_object);
         }
-        data = segment_object->_parse_metadata(data);
-        obj->_previous_segment_object = segment_object;
+        data = segment_object->_parse_metadata(data, e);
+        objects._previous(obj) = segment_object;
     }
     _calculate_chunks();
 }
@@ -224,17 +273,28 @@ void segment::_calculate_chunks()
     
     // Count the datasize
     long long data_size = 0;
+    size_t daqmx_size = 0;
     std::for_each(
             _ordered_objects.begin(), 
             _ordered_objects.end(), 
-            [&data_size](std::shared_ptr<segment_object> o)
+            [&data_size, &daqmx_size](const segment_object* o)
             {
                 if(o->_has_data)
                 {
-                    data_size += o->_data_size;
+                    if(o->_is_daqmx)
+                        daqmx_size = std::max(daqmx_size, size_t(o->_data_size));
+                    else
+                        data_size += o->_data_size;
                 }
             }
         );
+    if(daqmx_size != 0 && data_size != 0)
+    {
+        throw std::runtime_error("Mixing DAQmx and non-DAQmx data in one "
+                "segment is not supported");
+    }
+    this->_daqmx_chunk_size = daqmx_size;
+    data_size += daqmx_size;
     long long total_data_size = this->_next_segment_offset - this->_raw_data_offset;
 
     if(data_size < 0 || total_data_size < 0)
@@ -267,32 +327,71 @@ void segment::_calculate_chunks()
     {
         if(obj->_has_data)
         {
-            obj->_tdms_object->_number_values 
+            _parent_file->_objects._number_values[obj->_object]
                 += (obj->_number_values * this->_num_chunks);
+            _parent_file->_objects._plan_values(obj->_object,
+                    obj->_number_values * this->_num_chunks,
+                    _parent_file->_options.block_size);
         }
     }
 }
 
 void segment::_parse_raw_data()
 {
-    if(!this->_toc["kTocRawData"])
+    if(!this->_has(kTocRawData) && !this->_has(kTocDAQmxRawData))
         return;
-    size_t total_data_size = _next_segment_offset - _raw_data_offset;
 
-    endianness e = LITTLE;
+    endianness e = _endianness;
     const unsigned char* d = _data;
 
-    if(this->_toc["kTocBigEndian"])
-    {
-        throw std::runtime_error("Big endian reading not yet implemented");
-        e = BIG;
-    }
     for(size_t chunk = 0; chunk < _num_chunks; ++chunk)
     {
-        if(this->_toc["kTocInterleavedData"])
+        if(this->_daqmx_chunk_size != 0)
+        {
+            log::debug << "Data is DAQmx raw data" << log::endl;
+            for(auto obj : _ordered_objects)
+            {
+                if(obj->_has_data)
+                {
+                    obj->_read_daqmx_values(d, e);
+                }
+            }
+            d += _daqmx_chunk_size;
+        }
+        else if(this->_has(kTocInterleavedData))
         {
             log::debug << "Data is interleaved" << log::endl;
-            throw std::runtime_error("Reading inteleaved data not supported yet");
+            // Every object has the same number of values, stored as rows
+            // holding one value of each object.
+            size_t row_size = 0;
+            size_t number_values = 0;
+            for(auto obj : _ordered_objects)
+            {
+                if(!obj->_has_data)
+                    continue;
+                if(obj->_data_type->length == 0)
+                {
+                    throw std::runtime_error("Interleaved data of a variable "
+                            "length type is not supported");
+                }
+                if(row_size != 0 && obj->_number_values != number_values)
+                {
+                    throw std::runtime_error("Interleaved objects don't have "
+                            "the same number of values");
+                }
+                number_values = obj->_number_values;
+                row_size += obj->_data_type->length;
+            }
+            size_t offset = 0;
+            for(auto obj : _ordered_objects)
+            {
+                if(obj->_has_data)
+                {
+                    obj->_read_values(d + offset, row_size, e);
+                    offset += obj->_data_type->length;
+                }
+            }
+            d += row_size * number_values;
         }
         else
         {
@@ -301,55 +400,140 @@ void segment::_parse_raw_data()
             {
                 if(obj->_has_data)
                 {
-                    obj->_read_values(d, e);
+                    obj->_read_values(d, obj->_data_type->length, e);
+                    d += obj->_number_values * obj->_data_type->length;
                 }
             }
         }
     }
 }
 
-void segment_object::_read_values(const unsigned char*& data, endianness e)
+void segment_object::_read_values(const unsigned char* data, size_t stride,
+        endianness e)
 {
-    if(_data_type.name == "tdsTypeString")
+    if(_table->_flags[_object] & object_table::SKIPPED)
+    {
+        return;
+    }
+    else if(_data_type->name == "tdsTypeString")
     {
         log::debug << "Reading string data" << log::endl;
         throw std::runtime_error("Reading string data not yet implemented");
         // TODO ^
     }
+    else if(_table->_flags[_object] & object_table::CACHED)
+    {
+        // Decoded on demand
+        _table->_add_extent(_object, object::extent{data, stride,
+                _number_values, _data_type->numeric, -1, e == BIG});
+    }
     else
     {
-        unsigned char* read_data = ((unsigned char*)_tdms_object->_data) + _tdms_object->_data_insert_position;
+        void* read_data = _table->_insert_values(_object, _number_values);
 
-        _data_type.read_array_to(data, read_data, _number_values);
-
-        _tdms_object->_data_insert_position += (_number_values*_data_type.ctype_length);
-        data += (_number_values*_data_type.ctype_length);
+        if(read_data == nullptr)
+        {
+            // Already decoded
+        }
+        else if(_data_type->numeric != numeric_type::NONE)
+        {
+            numeric_type decoded = (_data_type->numeric == numeric_type::EXTENDED)
+                ? numeric_type::FLOAT64 : _data_type->numeric;
+            kernels::converter(_data_type->numeric, decoded, e == BIG)(
+                    data, stride, read_data, _number_values);
+        }
+        else if(stride == _data_type->length && e == LITTLE)
+        {
+            _data_type->read_array_to(data, read_data, _number_values);
+        }
+        else
+        {
+            throw std::runtime_error("Reading " + _data_type->name
+                    + " interleaved or big endian is not supported");
+        }
+        _table->_add_extent(_object, object::extent{data, stride,
+                _number_values, _data_type->numeric, -1, e == BIG});
     }
 }
 
-segment::~segment()
+void segment_object::_read_daqmx_values(const unsigned char* chunk,
+        endianness e)
 {
-}
+    if(_table->_flags[_object] & object_table::SKIPPED)
+        return;
+    // The raw buffers follow each other in the chunk, each holding
+    // _number_values samples of its raw data width. The scaler picks
+    // its bytes out of every sample of its buffer.
+    const daqmx_scaler& scaler = _daqmx_scalers.front();
+    const unsigned char* source = chunk;
+    for(uint32_t b = 0; b < scaler.raw_buffer_index; ++b)
+    {
+        source += _daqmx_raw_data_widths[b] * _number_values;
+    }
+    size_t stride = _daqmx_raw_data_widths[scaler.raw_buffer_index];
 
+    // With a channel cache or reused values only the extent is recorded
+    unsigned char* target = (_table->_flags[_object] & object_table::CACHED)
+        ? nullptr : (unsigned char*)_table->_insert_values(_object, _number_values);
+    bool decode = (target != nullptr);
+    if(_daqmx_digital_line)
+    {
+        source += scaler.raw_byte_offset / 8;
+        int bit = scaler.raw_byte_offset % 8;
+        if(decode)
+        {
+            // Lines are extracted as doubles, through a small buffer
+            kernels::convert_t convert = kernels::converter(
+                    numeric_type::FLOAT64, scaler.data_type);
+            size_t target_size = numeric_type_size(scaler.data_type);
+            const size_t block = 256;
+            double tmp[block];
+            for(size_t i = 0; i < _number_values; i += block)
+            {
+                size_t n = std::min<size_t>(block, _number_values - i);
+                kernels::extract_bits(source + i*stride, stride, bit, tmp, n);
+                convert((const unsigned char*) tmp, sizeof(double),
+                        target + i*target_size, n);
+            }
+        }
+        _table->_add_extent(_object, object::extent{source, stride,
+                _number_values, numeric_type::UINT8, bit, false});
+    }
+    else
+    {
+        source += scaler.raw_byte_offset;
+        if(decode)
+            kernels::converter(scaler.data_type, scaler.data_type, e == BIG)(
+                    source, stride, target, _number_values);
+        _table->_add_extent(_object, object::extent{source, stride,
+                _number_values, scaler.data_type, -1, e == BIG});
+    }
+}
 
-segment_object::segment_object(object* o)
-    : _tdms_object(o),
-      _data_type(data_type_t::_tds_datatypes.at(0))
+segment_object::segment_object(object_table* table, uint32_t o, arena* a)
+    : _table(table),
+      _object(o),
+      _daqmx_scalers(arena_allocator<daqmx_scaler>(a)),
+      _daqmx_raw_data_widths(arena_allocator<uint32_t>(a)),
+      _data_type(&data_type_t::_tds_datatypes.at(0))
 {
     _number_values = 0;
     _data_size = 0;
     _has_data = true;
+    _is_daqmx = false;
+    _daqmx_digital_line = false;
     //_data_type = None;
     //_dimension = 1;
 }
 
-const unsigned char* segment_object::_parse_metadata(const unsigned char* data)
+const unsigned char* segment_object::_parse_metadata(const unsigned char* data,
+        endianness e)
 {
     // Read object metadata and update object information
-    uint32_t raw_data_index = read_le<uint32_t>(data);
+    uint32_t raw_data_index = read_number<uint32_t>(data, e);
     data += 4;
 
-    log::debug << "Reading metadata for object " << _tdms_object->_path << log::endl
+    log::debug << "Reading metadata for object " << _table->_paths[_object].str() << log::endl
         << "raw_data_index: " << raw_data_index << log::endl;
 
     if(raw_data_index == 0xFFFFFFFF)
@@ -363,91 +547,215 @@ const unsigned char* segment_object::_parse_metadata(const unsigned char* data)
             "as in the previous segment" << log::endl;
         _has_data = true;
     }
+    else if(raw_data_index == daqmx_format_changing_scaler
+            || raw_data_index == daqmx_digital_line_scaler)
+    {
+        _has_data = true;
+        _table->_flags[_object] |= object_table::HAS_DATA;
+        data = _parse_daqmx_metadata(data, raw_data_index, e);
+    }
     else
     {
         // raw_data_index gives the length of the index information.
-        _tdms_object->_has_data = _has_data = true;
+        _has_data = true;
+        _table->_flags[_object] |= object_table::HAS_DATA;
         // Read the datatype
-        uint32_t datatype = read_le<uint32_t>(data);
+        uint32_t datatype = read_number<uint32_t>(data, e);
         data += 4;
 
         try
         {
-            _data_type = data_type_t::_tds_datatypes.at(datatype);
+            _data_type = &data_type_t::_tds_datatypes.at(datatype);
         }
         catch(std::out_of_range& e)
         {
             throw std::out_of_range("Unrecognized datatype in file");
         }
-        if(_tdms_object->_data_type.is_valid()
-                and _tdms_object->_data_type != _data_type)
+        if(_table->_types[_object]->is_valid()
+                and *_table->_types[_object] != *_data_type)
         {
             throw std::runtime_error("Segment object doesn't have the same data "
                     "type as previous segments");
         }
         else
         {
-            _tdms_object->_data_type = _data_type;
+            _table->_types[_object] = _data_type;
         }
 
-        log::debug << "datatype " << _data_type.name << log::endl;
+        log::debug << "datatype " << _data_type->name << log::endl;
 
         // Read data dimension
-        _dimension = read_le<uint32_t>(data);
+        _dimension = read_number<uint32_t>(data, e);
         data += 4;
         if(_dimension != 1)
             log::debug << "Warning: dimension != 0" << log::endl;
 
         // Read the number of values
-        _number_values = read_le<uint64_t>(data);
+        _number_values = read_number<uint64_t>(data, e);
         data += 8;
 
         // Variable length datatypes have total length
-        if(_data_type.name == "tdsTypeString" /*or None*/)
+        if(_data_type->name == "tdsTypeString" /*or None*/)
         {
-            _data_size = read_le<uint64_t>(data);
+            _data_size = read_number<uint64_t>(data, e);
             data += 8;
         }
         else
         {
-            _data_size = (_number_values * _dimension * _data_type.length);
+            _data_size = (_number_values * _dimension * _data_type->length);
         }
         log::debug << "Number of elements in segment: " << _number_values << log::endl;
     }
     // Read data properties
-    uint32_t num_properties = read_le<uint32_t>(data);
+    uint32_t num_properties = read_number<uint32_t>(data, e);
     data += 4;
     log::debug << "Reading " << num_properties << " properties" << log::endl;
     for(size_t i = 0; i < num_properties; ++i)
     {
-        std::string prop_name = read_string(data);
-        data += 4 + prop_name.size();
+        object_table::property_entry p;
+        p.name = read_string_ref(data, e);
+        data += 4 + p.name.size;
         // Property data type
-        auto prop_data_type = data_type_t::_tds_datatypes.at(read_le<uint32_t>(data));
+        p.type = &data_type_t::_tds_datatypes.at(read_number<uint32_t>(data, e));
         data += 4;
-        if(prop_data_type.name == "tdsTypeString")
+        // Only skip the value, it's decoded when asked for
+        p.value = data;
+        p.big_endian = (e == BIG);
+        if(p.type->name == "tdsTypeString")
         {
-            std::string* property = new std::string(read_string(data));
-            log::debug << "Property " << prop_name << ": " << *property << log::endl;
-            data += 4 + property->size();
-            _tdms_object->_properties.emplace(prop_name, 
-                std::shared_ptr<object::property>(
-                    new object::property(prop_data_type, (void*)property)));
+            data += 4 + read_number<uint32_t>(data, e);
         }
         else
         {
-            void* prop_val = prop_data_type.read(data);
-            if(prop_val == nullptr)
+            if(p.type->ctype_length == 0)
             {
-                throw std::runtime_error("Unsupported datatype " + prop_data_type.name);
+                throw std::runtime_error("Unsupported datatype " + p.type->name);
             }
-            data += prop_data_type.length;
-            _tdms_object->_properties.emplace(prop_name, 
-                std::shared_ptr<object::property>(
-                    new object::property(prop_data_type, prop_val)));
+            data += p.type->length;
+        }
+        _table->_add_property(_object, p);
+    }
+
+    return data;
+}
+
+std::shared_ptr<object::property> segment_object::_read_property(
+        const object_table::property_entry& p)
+{
+    if(p.type->name == "tdsTypeString")
+    {
+        string_ref value = read_string_ref(p.value, p.big_endian ? BIG : LITTLE);
+        return std::shared_ptr<object::property>(
+                new object::property(*p.type, new std::string(value.data, value.size)),
+                [](object::property* property){
+                    delete (std::string*) property->value;
+                    delete property;
+                });
+    }
+    void* value = malloc(p.type->ctype_length);
+    if(value == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    p.type->read(p.value, value, p.big_endian);
+    return std::shared_ptr<object::property>(new object::property(*p.type, value),
+            [](object::property* property){
+                free(property->value);
+                delete property;
+            });
+}
+
+const unsigned char* segment_object::_parse_daqmx_metadata(
+        const unsigned char* data, uint32_t raw_data_index, endianness e)
+{
+    log::debug << "Object has DAQmx raw data" << log::endl;
+    _is_daqmx = true;
+    _daqmx_digital_line = (raw_data_index == daqmx_digital_line_scaler);
+
+    uint32_t datatype = read_number<uint32_t>(data, e);
+    data += 4;
+    if(datatype != 0xFFFFFFFF)
+    {
+        throw std::runtime_error("DAQmx object doesn't have the DAQmx raw "
+                "data type");
+    }
+
+    _dimension = read_number<uint32_t>(data, e);
+    data += 4;
+    _number_values = read_number<uint64_t>(data, e);
+    data += 8;
+
+    uint32_t scaler_count = read_number<uint32_t>(data, e);
+    data += 4;
+    _daqmx_scalers.clear();
+    for(size_t i = 0; i < scaler_count; ++i)
+    {
+        daqmx_scaler scaler;
+        scaler.data_type = daqmx_data_type(read_number<uint32_t>(data, e));
+        data += 4;
+        scaler.raw_buffer_index = read_number<uint32_t>(data, e);
+        data += 4;
+        scaler.raw_byte_offset = read_number<uint32_t>(data, e);
+        data += 4;
+        if(_daqmx_digital_line)
+        {
+            scaler.sample_format_bitmap = data[0];
+            data += 1;
+        }
+        else
+        {
+            scaler.sample_format_bitmap = read_number<uint32_t>(data, e);
+            data += 4;
+        }
+        scaler.scale_id = read_number<uint32_t>(data, e);
+        data += 4;
+        log::debug << "DAQmx scaler " << scaler.scale_id << " in buffer "
+            << scaler.raw_buffer_index << " at offset "
+            << scaler.raw_byte_offset << log::endl;
+        _daqmx_scalers.push_back(scaler);
+    }
+
+    uint32_t width_count = read_number<uint32_t>(data, e);
+    data += 4;
+    _daqmx_raw_data_widths.clear();
+    size_t total_width = 0;
+    for(size_t i = 0; i < width_count; ++i)
+    {
+        _daqmx_raw_data_widths.push_back(read_number<uint32_t>(data, e));
+        total_width += _daqmx_raw_data_widths.back();
+        data += 4;
+    }
+
+    if(_daqmx_scalers.empty())
+    {
+        throw std::runtime_error("DAQmx object without scalers");
+    }
+    if(_daqmx_scalers.size() > 1)
+    {
+        throw std::runtime_error("DAQmx objects with more than one scaler "
+                "are not supported");
+    }
+    for(auto& scaler : _daqmx_scalers)
+    {
+        if(scaler.raw_buffer_index >= _daqmx_raw_data_widths.size())
+        {
+            throw std::runtime_error("DAQmx scaler refers to a non-existing "
+                    "raw buffer");
         }
     }
 
+    // The values keep the type of the scaler, which must not change
+    _data_type = &daqmx_raw_data_types.at(_daqmx_scalers.front().data_type);
+    const data_type_t* previous = _table->_types[_object];
+    if(previous->is_valid() and (*previous != *_data_type
+                or previous->numeric != _data_type->numeric))
+    {
+        throw std::runtime_error("Segment object doesn't have the same data "
+                "type as previous segments");
+    }
+    _table->_types[_object] = _data_type;
+
+    _data_size = _number_values * total_width;
     return data;
 }
 }
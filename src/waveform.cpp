@@ -0,0 +1,94 @@
+#include <stdexcept>
+#include <cmath>
+#include <algorithm>
+
+#include "waveform.hpp"
+
+namespace TDMS
+{
+
+namespace
+{
+
+double number(const std::shared_ptr<object::property>& p, const std::string& name)
+{
+    numeric_type t = p->data_type.numeric;
+    if(t == numeric_type::EXTENDED)
+        t = numeric_type::FLOAT64;
+    if(t == numeric_type::NONE)
+        throw std::runtime_error("Waveform property " + name + " isn't numeric");
+    double d;
+    kernels::converter(t, numeric_type::FLOAT64)(
+            (const unsigned char*) p->value, numeric_type_size(t), &d, 1);
+    return d;
+}
+
+}
+
+waveform::waveform(const object* o)
+    : _object(o)
+{
+    auto increment = o->get_property("wf_increment");
+    if(increment == nullptr)
+    {
+        throw std::runtime_error("Object " + o->get_path()
+                + " has no wf_increment");
+    }
+    _increment = number(increment, "wf_increment");
+    if(!(_increment > 0))
+    {
+        throw std::runtime_error("Object " + o->get_path()
+                + " has a wf_increment that isn't positive");
+    }
+    double offset = 0;
+    auto start_offset = o->get_property("wf_start_offset");
+    if(start_offset != nullptr)
+        offset = number(start_offset, "wf_start_offset");
+
+    for(const object_table::start_time& s : o->_table->_start_times_of(o->_index))
+    {
+        timestamp t;
+        s.value.type->read(s.value.value, &t, s.value.big_endian);
+        _runs.push_back(run{size_t(s.first_value), t.unix_time() + offset});
+    }
+    if(_runs.empty())
+        _runs.push_back(run{0, offset});
+    // Values before the first listed start time belong to it
+    _runs.front().first_value = 0;
+}
+
+std::vector<waveform::slice> waveform::find(double from, double to) const
+{
+    std::vector<slice> slices;
+    size_t number_values = _object->number_values();
+    for(size_t r = 0; r < _runs.size(); ++r)
+    {
+        size_t end = (r + 1 < _runs.size()) ? _runs[r + 1].first_value
+            : number_values;
+        size_t n = end - _runs[r].first_value;
+        double t = _runs[r].start_time;
+        double lo = std::ceil((from - t) / _increment);
+        double hi = std::ceil((to - t) / _increment);
+        size_t first = lo <= 0 ? 0 : size_t(std::min(lo, double(n)));
+        size_t last = hi <= 0 ? 0 : size_t(std::min(hi, double(n)));
+        if(first >= last)
+            continue;
+        slices.push_back(slice{_object, _runs[r].first_value + first,
+                last - first, t + double(first) * _increment, _increment});
+    }
+    return slices;
+}
+
+std::vector<waveform::slice> waveform::find(
+        const std::vector<const object*>& parts, double from, double to)
+{
+    std::vector<slice> slices;
+    for(const object* o : parts)
+    {
+        std::vector<slice> part = waveform(o).find(from, to);
+        slices.insert(slices.end(), part.begin(), part.end());
+    }
+    return slices;
+}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+
+#include "tdms.hpp"
+
+namespace TDMS
+{
+
+// Timing of a waveform channel, from its wf_start_time, wf_start_offset
+// and wf_increment properties, to look its values up by time.
+//
+// Segments that list a different wf_start_time start a new run of
+// values at that time; a start time repeated by every segment doesn't.
+// Times are seconds since the Unix epoch.
+class waveform
+{
+public:
+    // A run of values in a time range. The time of each value is
+    // computed from the start and the increment, never stored.
+    struct slice
+    {
+        const object* o;
+        size_t start;
+        size_t count;
+        double start_time;
+        double increment;
+
+        double time(size_t i) const
+        {
+            return start_time + double(i) * increment;
+        }
+        // Decodes only the values of the slice, like read_as
+        template<typename T>
+        size_t read(T* target) const
+        {
+            return read_as(o, target, start, count);
+        }
+    };
+
+    // Throws std::runtime_error when o has no wf_increment. Without a
+    // wf_start_time the first value is at time 0.
+    explicit waveform(const object* o);
+
+    double start_time() const
+    {
+        return _runs.front().start_time;
+    }
+    double increment() const
+    {
+        return _increment;
+    }
+
+    // The values with a time in [from, to), one slice per run
+    std::vector<slice> find(double from, double to) const;
+
+    // The same for a channel split over several files, given in order
+    static std::vector<slice> find(const std::vector<const object*>& parts,
+            double from, double to);
+private:
+    struct run
+    {
+        size_t first_value;
+        double start_time;
+    };
+    const object* _object;
+    double _increment;
+    std::vector<run> _runs;
+};
+
+}
@@ -0,0 +1,336 @@
+#include <stdexcept>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+#include "zone_map.hpp"
+#include "tdms_impl.hpp"
+
+namespace TDMS
+{
+
+namespace
+{
+
+const char magic[8] = {'T', 'D', 'M', 'S', 'p', 'p', 'Z', '2'};
+const size_t scan_block = 1024;
+
+// Without branches, so the comparisons vectorize
+template<bool LowInclusive, bool HighInclusive>
+void compare(const double* v, size_t n, double low, double high,
+        unsigned char* match)
+{
+    for(size_t i = 0; i < n; ++i)
+    {
+        match[i] = (LowInclusive ? v[i] >= low : v[i] > low)
+            & (HighInclusive ? v[i] <= high : v[i] < high);
+    }
+}
+
+typedef void (*compare_t)(const double*, size_t, double, double,
+        unsigned char*);
+
+const compare_t comparers[2][2] = {
+    {compare<false, false>, compare<false, true>},
+    {compare<true, false>, compare<true, true>}
+};
+
+// Joins runs that touch
+void add_range(std::vector<value_range>& out, size_t start, size_t count)
+{
+    if(!out.empty() && out.back().start + out.back().count == start)
+        out.back().count += count;
+    else
+        out.push_back(value_range{start, count});
+}
+
+void write(FILE* f, const void* data, size_t size, const std::string& path)
+{
+    if(size > 0 && fwrite(data, size, 1, f) != 1)
+    {
+        fclose(f);
+        throw std::runtime_error("Could not write \"" + path + "\"");
+    }
+}
+
+void read(FILE* f, void* data, size_t size, const std::string& path)
+{
+    if(size > 0 && fread(data, size, 1, f) != 1)
+    {
+        fclose(f);
+        throw std::runtime_error("Zone map \"" + path + "\" is truncated");
+    }
+}
+
+}
+
+zone_map::zone_map(const file& f)
+    : _table(&f._state->_objects),
+      _file_size(f._state->file_contents_size),
+      _file_mtime(f._state->file_contents_mtime)
+{
+    const object_table& t = *_table;
+    _ranges.assign(t.size(), object_table::range{0, 0});
+    for(uint32_t i = 0; i < t.size(); ++i)
+    {
+        array_view<object::extent> extents = t._extents_of(i);
+        if(!std::all_of(extents.begin(), extents.end(), _numeric))
+            continue;
+        _ranges[i] = object_table::range{uint32_t(_zones.size()),
+            uint32_t(extents.size())};
+        for(const object::extent& e : extents)
+            _zones.push_back(_summarize(e));
+    }
+}
+
+void zone_map::_decode(const object::extent& e, size_t offset,
+        double* target, size_t n)
+{
+    const unsigned char* source = e.data + offset*e.stride;
+    if(e.bit >= 0)
+        kernels::extract_bits(source, e.stride, e.bit, target, n);
+    else
+        kernels::converter(e.type, numeric_type::FLOAT64, e.big_endian)(
+                source, e.stride, target, n);
+}
+
+bool zone_map::_numeric(const object::extent& e)
+{
+    return e.bit >= 0 || kernels::summarizer(e.type, e.big_endian) != nullptr;
+}
+
+zone zone_map::_summarize(const object::extent& e)
+{
+    kernels::summary s = {std::numeric_limits<double>::infinity(),
+        -std::numeric_limits<double>::infinity(), 0};
+    double tmp[scan_block];
+    if(e.bit >= 0)
+    {
+        kernels::summarize_t summarize = kernels::summarizer(
+                numeric_type::FLOAT64);
+        for(size_t i = 0; i < e.number_values; i += scan_block)
+        {
+            size_t n = std::min(scan_block, e.number_values - i);
+            _decode(e, i, tmp, n);
+            summarize((const unsigned char*) tmp, sizeof(double), n, &s);
+        }
+    }
+    else
+    {
+        kernels::summarizer(e.type, e.big_endian)(e.data, e.stride,
+                e.number_values, &s);
+    }
+    zone z = {s.min, s.max, e.number_values, 0};
+    // The sum is only NaN with NaNs, or infinities of both signs
+    if(std::isnan(s.sum))
+    {
+        for(size_t i = 0; i < e.number_values; i += scan_block)
+        {
+            size_t n = std::min(scan_block, e.number_values - i);
+            _decode(e, i, tmp, n);
+            for(size_t j = 0; j < n; ++j)
+                z.nan_count += std::isnan(tmp[j]);
+        }
+    }
+    return z;
+}
+
+zone_map zone_map::load(const std::string& path, const file& f)
+{
+    FILE* in = fopen(path.c_str(), "rb");
+    if(!in)
+    {
+        throw std::runtime_error("Zone map \"" + path + "\" could not be opened");
+    }
+    zone_map m;
+    m._table = &f._state->_objects;
+    const object_table& t = *m._table;
+
+    char header[sizeof(magic)];
+    uint64_t rows;
+    read(in, header, sizeof(header), path);
+    read(in, &m._file_size, sizeof(m._file_size), path);
+    read(in, &m._file_mtime, sizeof(m._file_mtime), path);
+    read(in, &rows, sizeof(rows), path);
+    if(memcmp(header, magic, sizeof(magic)) != 0)
+    {
+        fclose(in);
+        throw std::runtime_error("\"" + path + "\" isn't a zone map");
+    }
+    if(m._file_size != f._state->file_contents_size
+            || m._file_mtime != f._state->file_contents_mtime)
+    {
+        fclose(in);
+        throw std::runtime_error("Zone map \"" + path
+                + "\" doesn't belong to this file");
+    }
+
+    // Rows are stored by path, the ones not stored hold no zones
+    m._ranges.assign(t.size(), object_table::range{0, 0});
+    std::string object_path;
+    for(uint64_t r = 0; r < rows; ++r)
+    {
+        uint32_t length, count;
+        read(in, &length, sizeof(length), path);
+        object_path.resize(length);
+        read(in, &object_path[0], length, path);
+        read(in, &count, sizeof(count), path);
+        int64_t i = t._find(string_ref(object_path.data(), object_path.size()));
+        if(i < 0 || t._extent_ranges[i].count != count)
+        {
+            fclose(in);
+            throw std::runtime_error("Zone map \"" + path
+                    + "\" doesn't belong to this file");
+        }
+        m._ranges[i] = object_table::range{uint32_t(m._zones.size()), count};
+        m._zones.resize(m._zones.size() + count);
+        read(in, m._zones.data() + m._ranges[i].begin, count * sizeof(zone), path);
+    }
+    fclose(in);
+    // Objects skipped when the zones were computed have none
+    for(uint32_t i = 0; i < t.size(); ++i)
+    {
+        array_view<object::extent> extents = t._extents_of(i);
+        if(m._ranges[i].count == 0 && !extents.empty() && _numeric(extents[0]))
+        {
+            throw std::runtime_error("Zone map \"" + path
+                    + "\" lacks zones of " + t._paths[i].str());
+        }
+    }
+    return m;
+}
+
+void zone_map::save(const std::string& path) const
+{
+    FILE* out = fopen(path.c_str(), "wb");
+    if(!out)
+    {
+        throw std::runtime_error("Could not create \"" + path + "\"");
+    }
+    const object_table& t = *_table;
+    uint64_t rows = std::count_if(_ranges.begin(), _ranges.end(),
+            [](const object_table::range& r){ return r.count > 0; });
+    write(out, magic, sizeof(magic), path);
+    write(out, &_file_size, sizeof(_file_size), path);
+    write(out, &_file_mtime, sizeof(_file_mtime), path);
+    write(out, &rows, sizeof(rows), path);
+    for(uint32_t i = 0; i < _ranges.size(); ++i)
+    {
+        const object_table::range& r = _ranges[i];
+        if(r.count == 0)
+            continue;
+        uint32_t length = uint32_t(t._paths[i].size);
+        write(out, &length, sizeof(length), path);
+        write(out, t._paths[i].data, length, path);
+        write(out, &r.count, sizeof(r.count), path);
+        write(out, _zones.data() + r.begin, r.count * sizeof(zone), path);
+    }
+    if(fclose(out) != 0)
+    {
+        throw std::runtime_error("Could not write \"" + path + "\"");
+    }
+}
+
+zone_map zone_map::cached(const std::string& path, const file& f)
+{
+    try
+    {
+        return load(path, f);
+    }
+    catch(std::runtime_error& e)
+    {
+        log::debug << e.what() << ", computing the zones" << log::endl;
+    }
+    zone_map m(f);
+    try
+    {
+        m.save(path);
+    }
+    catch(std::runtime_error& e)
+    {
+        log::debug << e.what() << log::endl;
+    }
+    return m;
+}
+
+const object_table::range& zone_map::_range_of(const object* o) const
+{
+    if(o->_table != _table)
+    {
+        throw std::invalid_argument("Object " + o->get_path()
+                + " isn't part of the file of the zone map");
+    }
+    return _ranges[o->_index];
+}
+
+array_view<zone> zone_map::zones(const object* o) const
+{
+    const object_table::range& r = _range_of(o);
+    return array_view<zone>(_zones.data() + r.begin, r.count);
+}
+
+std::vector<value_range> zone_map::find_ranges(const object* o,
+        const predicate& p) const
+{
+    const object_table::range& r = _range_of(o);
+    const object_table& t = *_table;
+    if(t._flags[o->_index] & object_table::SKIPPED)
+    {
+        throw std::runtime_error("Object " + o->get_path()
+                + " wasn't selected when opening");
+    }
+    array_view<object::extent> extents = t._extents_of(o->_index);
+    if(r.count != extents.size())
+    {
+        throw std::runtime_error("Object " + o->get_path()
+                + " doesn't hold numeric data");
+    }
+
+    std::vector<value_range> out;
+    size_t first = 0;
+    for(size_t x = 0; x < extents.size(); ++x)
+    {
+        const zone& z = _zones[r.begin + x];
+        bool overlaps = z.count > z.nan_count
+            && (p.low_inclusive ? z.max >= p.low : z.max > p.low)
+            && (p.high_inclusive ? z.min <= p.high : z.min < p.high);
+        if(overlaps && z.nan_count == 0 && p(z.min) && p(z.max))
+            add_range(out, first, z.count);
+        else if(overlaps)
+            _scan(extents[x], first, p, out);
+        first += extents[x].number_values;
+    }
+    return out;
+}
+
+void zone_map::_scan(const object::extent& e, size_t first,
+        const predicate& p, std::vector<value_range>& out)
+{
+    compare_t compare = comparers[p.low_inclusive][p.high_inclusive];
+    double values[scan_block];
+    unsigned char match[scan_block];
+    size_t run = 0;
+    for(size_t i = 0; i < e.number_values; i += scan_block)
+    {
+        size_t n = std::min(scan_block, e.number_values - i);
+        _decode(e, i, values, n);
+        compare(values, n, p.low, p.high, match);
+        for(size_t j = 0; j < n; ++j)
+        {
+            if(match[j])
+            {
+                ++run;
+            }
+            else if(run > 0)
+            {
+                add_range(out, first + i + j - run, run);
+                run = 0;
+            }
+        }
+    }
+    if(run > 0)
+        add_range(out, first + e.number_values - run, run);
+}
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <limits>
+
+#include "tdms.hpp"
+
+namespace TDMS
+{
+
+// Statistics of the values of an object in one segment. NaNs are left
+// out of min and max, which are infinite when there are no other values.
+struct zone
+{
+    double min;
+    double max;
+    uint64_t count;
+    uint64_t nan_count;
+};
+
+// Matches the values in an interval, each end of which is open, closed
+// or unbounded. NaNs never match.
+struct predicate
+{
+    double low;
+    double high;
+    bool low_inclusive;
+    bool high_inclusive;
+
+    static predicate greater(double v)
+    {
+        return predicate{v, std::numeric_limits<double>::infinity(), false, true};
+    }
+    static predicate greater_equal(double v)
+    {
+        return predicate{v, std::numeric_limits<double>::infinity(), true, true};
+    }
+    static predicate less(double v)
+    {
+        return predicate{-std::numeric_limits<double>::infinity(), v, true, false};
+    }
+    static predicate less_equal(double v)
+    {
+        return predicate{-std::numeric_limits<double>::infinity(), v, true, true};
+    }
+    // Both ends included
+    static predicate between(double low, double high)
+    {
+        return predicate{low, high, true, true};
+    }
+
+    bool operator()(double v) const
+    {
+        return (low_inclusive ? v >= low : v > low)
+            && (high_inclusive ? v <= high : v < high);
+    }
+};
+
+// A run of consecutive values
+struct value_range
+{
+    size_t start;
+    size_t count;
+};
+
+// Zones of every numeric object of a file, one per segment the object
+// has values in. Zones are on the raw values, before scaling.
+class zone_map
+{
+public:
+    // Summarizes the raw data of every numeric object of f
+    explicit zone_map(const file& f);
+
+    // Reads zones written by save. Throws if they don't belong to f,
+    // which is the case after f was appended to or rewritten: the size
+    // and modification time of f are checked.
+    static zone_map load(const std::string& path, const file& f);
+    void save(const std::string& path) const;
+
+    // Loads the zones from path if they belong to f, otherwise
+    // computes them and tries to save them there for next time
+    static zone_map cached(const std::string& path, const file& f);
+
+    // Where the zones of a TDMS file are kept, next to its index file
+    static std::string sidecar_path(const std::string& filename)
+    {
+        return filename + "_zones";
+    }
+
+    // The zones of o in segment order, empty for non-numeric objects
+    array_view<zone> zones(const object* o) const;
+
+    // Runs of values of o that match p. Segments whose zone rules out a
+    // match are skipped and segments whose zone matches as a whole
+    // aren't read, only the others are scanned.
+    std::vector<value_range> find_ranges(const object* o,
+            const predicate& p) const;
+private:
+    zone_map() = default;
+    const object_table::range& _range_of(const object* o) const;
+    // Decodes n values of an extent, from value offset on, as doubles
+    static void _decode(const object::extent& e, size_t offset,
+            double* target, size_t n);
+    static bool _numeric(const object::extent& e);
+    static zone _summarize(const object::extent& e);
+    static void _scan(const object::extent& e, size_t first,
+            const predicate& p, std::vector<value_range>& out);
+
+    const object_table* _table;
+    // Appending to or rewriting a file makes its zones stale
+    uint64_t _file_size;
+    int64_t _file_mtime;
+    std::vector<object_table::range> _ranges;
+    std::vector<zone> _zones;
+};
+
+}
@@ -0,0 +1,214 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <decode_kernels.hpp>
+#include <tdms.hpp>
+#include <page_allocator.hpp>
+
+#include "optionparser.h"
+
+// Define options
+enum optionIndex {UNKNOWN, HELP, ISA, ALL, SIZE, POLICIES};
+
+const option::Descriptor usage[] =
+{
+    {UNKNOWN,    0, "" , "",           option::Arg::None,     "USAGE: tdmsppbench [options]\n\n"
+                                                              "Measures the throughput of the decode kernels.\n\n"
+                                                              "Options:"},
+    {HELP,       0, "h", "help",       option::Arg::None,     "  --help, \tPrint usage and exit."},
+    {ISA,        0, "i", "isa",        option::Arg::Optional, "  --isa=NAME, \tUse these kernels instead of the detected ones."},
+    {ALL,        0, "a", "all",        option::Arg::None,     "  --all, \tBenchmark every variant this CPU supports."},
+    {SIZE,       0, "s", "size",       option::Arg::Optional, "  --size=MB, \tSource buffer size in megabytes (default 64)."},
+    {POLICIES,   0, "p", "policies",   option::Arg::Optional, "  --policies=FILE, \tTime decoding and scanning FILE under each allocation policy."},
+    {0, 0, 0, 0, 0, 0}
+};
+
+using TDMS::numeric_type;
+
+struct benchmark
+{
+    const char* name;
+    numeric_type from;
+    numeric_type to;
+    size_t stride;
+    bool big_endian;
+};
+
+const benchmark benchmarks[] = {
+    {"copy i16",              numeric_type::INT16,   numeric_type::INT16,   2,  false},
+    {"byte-swap i32",         numeric_type::INT32,   numeric_type::INT32,   4,  true},
+    {"de-interleave f32 (4)", numeric_type::FLOAT32, numeric_type::FLOAT32, 16, false},
+    {"convert i16 -> f64",    numeric_type::INT16,   numeric_type::FLOAT64, 2,  false},
+    {"convert f32 -> f64",    numeric_type::FLOAT32, numeric_type::FLOAT64, 4,  false},
+    {"convert i32 -> f32",    numeric_type::INT32,   numeric_type::FLOAT32, 4,  false},
+};
+
+void run(const std::vector<unsigned char>& source, std::vector<unsigned char>& target)
+{
+    std::cout << "Kernels: " << TDMS::kernels::active().name << std::endl;
+    for(const benchmark& b : benchmarks)
+    {
+        size_t n = source.size() / b.stride;
+        size_t target_size = TDMS::numeric_type_size(b.to);
+        if(target.size() < n * target_size)
+            target.resize(n * target_size);
+        TDMS::kernels::convert_t convert = TDMS::kernels::converter(b.from, b.to, b.big_endian);
+
+        // Warm up, then keep the best of a few runs
+        convert(source.data(), b.stride, target.data(), n);
+        double best = 1e300;
+        for(int run = 0; run < 5; ++run)
+        {
+            auto start = std::chrono::steady_clock::now();
+            convert(source.data(), b.stride, target.data(), n);
+            std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+            if(d.count() < best)
+                best = d.count();
+        }
+        std::cout << "  " << b.name << ": "
+            << (n / best / 1e6) << " Msamples/s, "
+            << (n * b.stride / best / 1e9) << " GB/s read" << std::endl;
+    }
+}
+
+struct policy
+{
+    const char* name;
+    TDMS::data_allocator* allocator;
+};
+
+// Sums all decoded bytes, a stand-in for an analysis pass
+volatile uint64_t scan_result;
+uint64_t scan(TDMS::file& f)
+{
+    uint64_t sum = 0;
+    for(TDMS::object* o : f)
+    {
+        size_t value_size = o->number_values() ? o->bytes() / o->number_values() : 0;
+        for(const TDMS::object::block& b : o->blocks())
+        {
+            const unsigned char* p = (const unsigned char*) b.data;
+            size_t n = b.number_values * value_size;
+            size_t i = 0;
+            for(; i + 8 <= n; i += 8)
+            {
+                uint64_t v;
+                std::memcpy(&v, p + i, 8);
+                sum += v;
+            }
+            for(; i < n; ++i)
+                sum += p[i];
+        }
+    }
+    return sum;
+}
+
+void run_policies(const std::string& filename)
+{
+    TDMS::page_allocator normal(TDMS::page_policy::NORMAL);
+    TDMS::page_allocator transparent(TDMS::page_policy::TRANSPARENT_HUGE);
+    TDMS::page_allocator hugetlb(TDMS::page_policy::HUGETLB);
+    TDMS::page_allocator transparent_local(TDMS::page_policy::TRANSPARENT_HUGE, true);
+    const policy policies[] = {
+        {"malloc",                      nullptr},
+        {"normal pages",                &normal},
+        {"transparent huge pages",      &transparent},
+        {"hugetlb",                     &hugetlb},
+        {"transparent huge, local node", &transparent_local},
+    };
+    for(const policy& p : policies)
+    {
+        double best_open = 1e300, best_scan = 1e300;
+        size_t bytes = 0;
+        uint64_t sum = 0;
+        for(int run = 0; run < 3; ++run)
+        {
+            TDMS::file_options options;
+            options.allocator = p.allocator;
+            auto start = std::chrono::steady_clock::now();
+            TDMS::file f(filename, options);
+            std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+            best_open = std::min(best_open, d.count());
+
+            start = std::chrono::steady_clock::now();
+            sum += scan(f);
+            d = std::chrono::steady_clock::now() - start;
+            best_scan = std::min(best_scan, d.count());
+            bytes = f.memory().decoded;
+        }
+        std::cout << "  " << p.name << ": open " << best_open * 1e3 << " ms, "
+            << "scan " << (bytes / best_scan / 1e9) << " GB/s" << std::endl;
+        scan_result = sum;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    // Parse options
+    argc -= (argc>0); argv+=(argc>0); // Skip the program name if present
+    option::Stats stats(usage, argc, argv);
+    option::Option options[stats.options_max], buffer[stats.buffer_max];
+    option::Parser parse(usage, argc, argv, options, buffer);
+
+    if(parse.error())
+    {
+        std::cerr << "parse.error() != 0" << std::endl;
+        return 1;
+    }
+    if(options[HELP] || options[UNKNOWN])
+    {
+        option::printUsage(std::cout, usage);
+        return 0;
+    }
+
+    if(options[POLICIES])
+    {
+        if(!options[POLICIES].arg)
+        {
+            std::cerr << "--policies needs a file" << std::endl;
+            return 1;
+        }
+        run_policies(options[POLICIES].arg);
+        return 0;
+    }
+
+    size_t megabytes = 64;
+    if(options[SIZE] && options[SIZE].arg)
+    {
+        megabytes = std::strtoul(options[SIZE].arg, nullptr, 10);
+    }
+    std::vector<unsigned char> source(megabytes << 20);
+    for(size_t i = 0; i < source.size(); ++i)
+    {
+        source[i] = (unsigned char)(i * 2654435761u >> 13);
+    }
+    std::vector<unsigned char> target;
+
+    std::cout << "Available kernels:";
+    for(const TDMS::kernels::kernel_table* t : TDMS::kernels::available())
+        std::cout << " " << t->name;
+    std::cout << std::endl;
+
+    if(options[ALL])
+    {
+        for(const TDMS::kernels::kernel_table* t : TDMS::kernels::available())
+        {
+            TDMS::kernels::select(t->name);
+            run(source, target);
+        }
+        return 0;
+    }
+    if(options[ISA] && options[ISA].arg)
+    {
+        if(!TDMS::kernels::select(options[ISA].arg))
+        {
+            std::cerr << "Kernels " << options[ISA].arg << " are not available" << std::endl;
+            return 1;
+        }
+    }
+    run(source, target);
+}
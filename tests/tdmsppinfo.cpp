@@ -7,7 +7,7 @@
 #include "optionparser.h"
 
 // Define options
-enum optionIndex {UNKNOWN, HELP, PROPERTIES, DEBUG};
+enum optionIndex {UNKNOWN, HELP, PROPERTIES, MEMORY, CHANNELS, DEBUG};
 
 const option::Descriptor usage[] = 
 {
@@ -15,6 +15,8 @@ const option::Descriptor usage[] =
                                                           "Options:"},
     {HELP,       0, "h", "help",       option::Arg::None, "  --help, \tPrint usage and exit."},
     {PROPERTIES, 0, "p", "properties", option::Arg::None, "  --properties, \tPrint channel properties."},
+    {MEMORY,     0, "m", "memory",     option::Arg::None, "  --memory, \tPrint the memory used per channel and in total."},
+    {CHANNELS,   0, "c", "channels",   option::Arg::Optional, "  --channels=GLOB, \tOnly list objects whose path matches GLOB."},
     {DEBUG,      0, "d", "debug",      option::Arg::None, "  --debug, \tPrint debugging information to stderr."},
     {0, 0, 0, 0, 0, 0}
 };
@@ -51,9 +53,20 @@ int main(int argc, char** argv)
     {
         if(_filenames.size() > 1)
             std::cout << filename << ":" << std::endl;
-        TDMS::file f(filename);
+        // Values are only decoded to report their memory
+        TDMS::file_options file_options;
+        std::function<bool (const TDMS::object&)> listed;
+        if(options[CHANNELS] && options[CHANNELS].arg)
+            listed = TDMS::select_glob(options[CHANNELS].arg);
+        if(!options[MEMORY])
+            file_options.select = [](const TDMS::object&){ return false; };
+        else
+            file_options.select = listed;
+        TDMS::file f(filename, file_options);
         for(TDMS::object* o : f)
         {
+            if(listed && !listed(*o))
+                continue;
             std::cout << o->get_path() << std::endl;
             if(options[PROPERTIES])
             {
@@ -63,6 +76,25 @@ int main(int argc, char** argv)
                     // TODO: implement value for C++ usage.
                 }
             }
+            if(options[MEMORY])
+            {
+                TDMS::memory_usage m = o->memory();
+                std::cout << "  memory: " << m.objects << " bytes object, "
+                    << m.properties << " bytes properties, "
+                    << m.decoded << " bytes decoded" << std::endl;
+            }
+        }
+        if(options[MEMORY])
+        {
+            TDMS::memory_usage m = f.memory();
+            std::cout << "Memory:" << std::endl
+                << "  objects:    " << m.objects << std::endl
+                << "  properties: " << m.properties << std::endl
+                << "  segments:   " << m.segments << std::endl
+                << "  decoded:    " << m.decoded << std::endl
+                << "  total:      " << m.total() << std::endl
+                << "  metadata arena reserved: " << m.arena_reserved << std::endl
+                << "  file contents mapped:    " << m.mapped << std::endl;
         }
     }
 }